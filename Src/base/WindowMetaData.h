@@ -22,13 +22,48 @@
 #ifndef WINDOWMETADATA_H
 #define WINDOWMETADATA_H
 
+#include <stdint.h>
+#include <string.h>
+
 struct WindowMetaData
 {
+	// pixel layout of the window buffer
+	enum SurfaceFormat {
+		SurfaceFormatARGB32 = 0,	// 32bpp premultiplied ARGB
+		SurfaceFormatRGB565		// 16bpp, opaque windows only
+	};
+
+	// how much of the window the host currently shows
+	enum HostVisibility {
+		HostVisible = 0,
+		HostOccluded,			// fully covered by other windows
+		HostOffScreen
+	};
+
 	void init() {
 		allowDirectRendering = false;
 		directRenderingScreenX = 0;
 		directRenderingScreenY = 0;
 		directRenderingOrientation = 0;
+		surfaceFormat = SurfaceFormatARGB32;
+		surfacePitch = 0;
+		hostSupportsRgb565 = 0;
+		atlasKey = 0;
+		atlasX = 0;
+		atlasY = 0;
+		opaque = 0;
+		hostVisibility = HostVisible;
+		thumbnailKey = 0;
+		thumbnailWidth = 0;
+		thumbnailHeight = 0;
+		thumbnailPitch = 0;
+		thumbnailScale = 0;
+		thumbnailSerial = 0;
+		sequence = 0;
+		frameCounter = 0;
+		hostFrameCounter = 0;
+		hostUsesDamageRing = 0;
+		::memset(damageRing, 0, sizeof(damageRing));
 	}
 	
 	void reset() {
@@ -42,6 +77,102 @@ struct WindowMetaData
 	int directRenderingScreenX;
 	int directRenderingScreenY;
 	int directRenderingOrientation;
+
+	// written by the app side whenever the window buffer changes layout
+	int surfaceFormat;
+	int surfacePitch;
+
+	// written by the host when it draws the buffer according to surfaceFormat.
+	// Until then the app only switches to RGB565 when told to at startup
+	volatile int hostSupportsRgb565;
+
+	// non zero when the window pixels are a rect at (atlasX, atlasY) of the
+	// shared buffer atlasKey, with surfacePitch bytes per line, instead of a
+	// buffer of their own. Damage is then in atlas coordinates. Such windows
+	// are routed by their metadata buffer key, the app only uses them when
+	// started with LUNA_WINDOW_ATLAS for a host that reads these fields
+	int atlasKey;
+	int atlasX;
+	int atlasY;
+
+	// non zero while every pixel the app paints is fully opaque: the host can
+	// draw the buffer without blending
+	int opaque;
+
+	// written by the host. While the window isn't HostVisible the app keeps
+	// collecting damage without rendering it, and checks the field a few times
+	// a second. Once the window is visible again the app renders everything it
+	// held back in one go
+	volatile int hostVisibility;
+
+	// small 32bpp copy of the window for the card switcher, in a separate buffer.
+	// thumbnailSerial is bumped every time the image or its layout changes and
+	// stays 0 while there is none. The buffer stays valid while the window is
+	// removed from the host for the app cache
+	int thumbnailKey;
+	int thumbnailWidth;
+	int thumbnailHeight;
+	int thumbnailPitch;
+	int thumbnailScale;
+	volatile uint32_t thumbnailSerial;
+
+	// Lock free damage channel.
+	//
+	// Every frame the app bumps frameCounter and stores its damage rect at
+	// damageRing[frameCounter % kDamageRingSize], inside a seqlock (sequence is
+	// odd while a write is in progress). A host that sets hostUsesDamageRing
+	// reads the ring for every frame after hostFrameCounter, then stores the
+	// last frame it consumed in hostFrameCounter and checks frameCounter again.
+	// The app only sends a ViewHost_UpdateWindowRegion doorbell when the host
+	// had consumed every earlier frame. If the host falls more than
+	// kDamageRingSize frames behind, it repaints the whole window.
+
+	static const int kDamageRingSize = 16;
+
+	struct DamageRect {
+		int x;
+		int y;
+		int w;
+		int h;
+	};
+
+	// app side. Returns true if the host needs a doorbell for this frame
+	bool publishDamage(int x, int y, int w, int h) {
+		__sync_fetch_and_add(&sequence, 1);
+		uint32_t frame = frameCounter + 1;
+		DamageRect& r = damageRing[frame % kDamageRingSize];
+		r.x = x;
+		r.y = y;
+		r.w = w;
+		r.h = h;
+		frameCounter = frame;
+		// full barrier: the frame is visible before we look at the host
+		__sync_fetch_and_add(&sequence, 1);
+		return !hostUsesDamageRing || hostFrameCounter == frame - 1;
+	}
+
+	// host side. Copies the damage of frame into r. Returns false if the frame
+	// is not published yet or was already overwritten
+	bool readDamage(uint32_t frame, DamageRect& r) const {
+		while (true) {
+			uint32_t seq = sequence;
+			if (seq & 1)
+				continue;
+			__sync_synchronize();
+			uint32_t last = frameCounter;
+			r = damageRing[frame % kDamageRingSize];
+			__sync_synchronize();
+			if (seq != sequence)
+				continue;
+			return (int32_t) (last - frame) >= 0 && (last - frame) < (uint32_t) kDamageRingSize;
+		}
+	}
+
+	volatile uint32_t sequence;
+	volatile uint32_t frameCounter;
+	volatile uint32_t hostFrameCounter;	// written by the host
+	volatile int hostUsesDamageRing;	// written by the host
+	DamageRect damageRing[kDamageRingSize];
 };
 
 #endif /* WINDOWMETADATA_H */
@@ -29,11 +29,18 @@
 #include "WebAppDeferredUpdateHandler.h"
 #include "WebAppManager.h"
 #include "WebAppFactory.h"
+#include "WebAppRotateTransition.h"
+#include "WebAppThumbnail.h"
+#include "WebAppTileCache.h"
+#include "WebPageEvents.h"
+#include "WebPageThrottle.h"
 #include "SysMgrWebBridge.h"
+#include "ThreadPriorityManager.h"
 #include "WindowTypes.h"
 #include "WindowMetaData.h"
 #include "Time.h"
 #include "EventReporter.h"
+#include "PixelKernels.h"
 #include "ApplicationDescription.h"
 
 #include <stdio.h>
@@ -72,6 +79,9 @@
 #include <QElapsedTimer>
 #endif
 
+// length of the orientation change transition and its frame clock
+static const int kRotateTransitionMs = 250;
+static const int kRotateTransitionFrameMs = 16;
 
 void CardWebApp::paintEvent(QPaintEvent* event)
 {
@@ -95,6 +105,7 @@ void CardWebApp::paintEvent(QPaintEvent* event)
             glFlush();
 #endif
             m_data->clear();
+            m_retainedFrame = false;
         }
         m_lastPaintIPCBuffer = false;
     } else {
@@ -114,12 +125,24 @@ void CardWebApp::paintEvent(QPaintEvent* event)
         if (m_beingDeleted)
             g_critical("FATAL ERROR: Being painted when deleted\n");
 
-        if (m_paintingDisabled)
+        // the damage is painted once the display is back on
+        if (m_displayOff) {
+            m_paintSuppressed = true;
             return;
+        }
+
+        // the damage stays in m_paintRect until the transition is over
+        if (m_rotateTransition)
+            return;
+
+        // explicitly requested repaints, before they are widened to the full buffer
+        QRect requested = m_paintRect;
 
         if (!m_data->supportsPartialUpdates())
             m_paintRect = QRect(0, 0, m_appBufWidth, m_appBufHeight);
 
+        m_paintStats.paintStarted();
+
         QPainter* paintContext = m_data->qtRenderingContext();
         m_data->beginPaint();
 #ifdef GFX_DEBUGGING
@@ -127,13 +150,30 @@ void CardWebApp::paintEvent(QPaintEvent* event)
         paintTime.start();
 #endif
         applyCardOrientation();
-        render(paintContext, m_paintRect, m_paintRect);
+        QRect rotated;
+        if (paintRotated(paintContext, requested, rotated))
+            m_paintRect = rotated;
+        else if (m_paintRect == requested || !m_tileCache ||
+                 !m_tileCache->paint(paintContext, m_paintRect, this))
+            render(paintContext, m_paintRect, m_paintRect);
         m_data->endPaint(false, QRect());
 #ifdef GFX_DEBUGGING
         qDebug() << page()->appId() << "manual paint took" << paintTime.elapsed() << "ms";
 #endif
         // notify WindowServer about paint update across IPC
-        m_data->sendWindowUpdate(m_paintRect.x(), m_paintRect.y(), m_paintRect.width(), m_paintRect.height());
+        if (!m_paintRect.isEmpty())
+            sendWindowUpdate(m_paintRect);
+
+        m_paintStats.paintFinished(m_paintRect.width() * m_paintRect.height());
+
+        // small damage is picked up by the next paint, or by the timer if
+        // no paint comes before it gets stale
+        if (m_thumbnail) {
+            if (m_thumbnail->needsUpdate())
+                m_thumbnail->update(m_data);
+            else if (m_thumbnail->hasPendingDamage() && !m_thumbnailTimer.running())
+                m_thumbnailTimer.start(m_thumbnail->msUntilStale());
+        }
 
         // clear to indicate we handled the dirty regions
         m_paintRect.setRect(0, 0, 0, 0);
@@ -176,10 +216,18 @@ CardWebApp::CardWebApp(WindowType::Type winType, PIpcChannel *channel, Applicati
 	, m_renderOffsetX(0)
 	, m_renderOffsetY(0)
 	, m_renderOrientation(Event::Orientation_Up)
-	, m_paintingDisabled(false)
 	, m_renderingSuspended(false)
     , m_glw(0)
     , m_lastPaintIPCBuffer(false)
+    , m_rotationBlit(::getenv("LUNA_DISABLE_ROTATIONBLIT") == 0)
+    , m_uprightSurface(0)
+    , m_rotateTransitions(::getenv("LUNA_DISABLE_ROTATE_TRANSITION") == 0)
+    , m_rotateTransition(0)
+    , m_rotateTransitionTimer(WebAppManager::instance()->masterTimer(),
+                              this, &CardWebApp::rotateTransitionTick)
+    , m_thumbnailTimer(WebAppManager::instance()->masterTimer(),
+                       this, &CardWebApp::thumbnailStaleTick)
+    , m_retainedFrame(false)
 {
 	if(desc != 0) {
 		std::string request = desc->requestedWindowOrientation();
@@ -280,6 +328,9 @@ CardWebApp::~CardWebApp()
 	}
     if (m_webview)
         delete m_webview;
+    releaseUprightSurface();
+    stopRotateTransition();
+    m_thumbnailTimer.stop();
     if (scene()) {
         delete scene();
         setScene(0);
@@ -613,6 +664,14 @@ void CardWebApp::keyEvent(QKeyEvent* e)
 
 void CardWebApp::paint()
 {
+    stopPaintTimer();
+
+    if (paintHeldBack()) {
+        m_paintSuppressed = true;
+        watchHostVisibility();
+        return;
+    }
+
     if (m_directRendering) {
         // direct rendering - let Qt handle the paints through QGLWidget
         scene()->update();
@@ -632,10 +691,13 @@ void CardWebApp::focusedEvent(bool focused)
 
 	WindowedWebApp::focusedEvent(focused);
 
-	if (focused)
+	if (focused) {
+		WebAppDeferredUpdateHandler::appFocused(this);
 		focusActivity();
-	else
+	}
+	else {
 		blurActivity();
+	}
 }
 
 /**
@@ -658,10 +720,208 @@ void CardWebApp::applyCardOrientation() {
         // if we paint the ipc buffer, we reset the transform to identity since the window manager will rotate for us
         QTransform t;
         t.rotate(angleForOrientation(m_orientation));
+        if (m_webview->transform() != t) {
+            if (m_tileCache)
+                m_tileCache->invalidateAll();
+            // the upright copy is still good, but all of it lands somewhere else now
+            if (m_uprightSurface)
+                m_uprightDirty = m_uprightSurface->rect();
+        }
         m_webview->setTransform(t);
     }
 }
 
+void CardWebApp::renderContents(QPainter* painter, const QRect& rect)
+{
+    render(painter, QRectF(rect), rect);
+}
+
+static int PrvRightAngle(const QTransform& t)
+{
+    // only pure rotations by a multiple of 90 degrees onto whole pixels
+    if (t.type() > QTransform::TxRotate ||
+        t.dx() != (int) t.dx() || t.dy() != (int) t.dy())
+        return -1;
+
+    if (t.m11() == 1 && t.m22() == 1 && t.m12() == 0 && t.m21() == 0)
+        return 0;
+    if (t.m12() == 1 && t.m21() == -1 && t.m11() == 0 && t.m22() == 0)
+        return 90;
+    if (t.m11() == -1 && t.m22() == -1 && t.m12() == 0 && t.m21() == 0)
+        return 180;
+    if (t.m12() == -1 && t.m21() == 1 && t.m11() == 0 && t.m22() == 0)
+        return 270;
+
+    return -1;
+}
+
+bool CardWebApp::paintRotated(QPainter* painter, const QRect& requested, QRect& updated)
+{
+    // Rendering through a rotated transform takes the slow transformed raster
+    // path for every pixel. Instead keep an upright copy of the page, only
+    // render the damage into it and rotate that part into the window buffer.
+    QTransform toBuffer = m_webview->deviceTransform(viewportTransform());
+    int angle = PrvRightAngle(toBuffer);
+    if (!m_rotationBlit || angle <= 0 || !page() || !page()->page()) {
+        releaseUprightSurface();
+        return false;
+    }
+
+    QPaintDevice* device = painter->device();
+    if (!device || device->devType() != QInternal::Image)
+        return false;
+
+    QImage* surface = static_cast<QImage*>(device);
+    if (surface->depth() != 16 && surface->depth() != 32)
+        return false;
+
+    QSize size = m_webview->size().toSize();
+    if (!m_uprightSurface || m_uprightSurface->size() != size ||
+        m_uprightSurface->format() != surface->format()) {
+
+        releaseUprightSurface();
+        m_uprightSurface = new QImage(size, surface->format());
+        if (m_uprightSurface->isNull()) {
+            releaseUprightSurface();
+            return false;
+        }
+
+        m_uprightDirty = m_uprightSurface->rect();
+
+        // the upright copy does the tiles' job while the card is rotated
+        if (m_tileCache)
+            m_tileCache->purge();
+    }
+
+    QTransform fromBuffer = toBuffer.inverted();
+    QRect visible = fromBuffer.mapRect(QRectF(surface->rect())).toAlignedRect() & m_uprightSurface->rect();
+
+    QRect dirty = m_uprightDirty & visible;
+    m_uprightDirty = QRect();
+
+    if (!dirty.isEmpty()) {
+        QPainter uprightPainter(m_uprightSurface);
+        if (!opaqueContent()) {
+            uprightPainter.setCompositionMode(QPainter::CompositionMode_Source);
+            uprightPainter.fillRect(dirty, Qt::transparent);
+            uprightPainter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+        }
+        page()->page()->mainFrame()->render(&uprightPainter, QRegion(dirty));
+        uprightPainter.end();
+    }
+
+    QRect source = dirty;
+    if (!requested.isEmpty())
+        source |= fromBuffer.mapRect(QRectF(requested)).toAlignedRect() & visible;
+
+    updated = toBuffer.mapRect(QRectF(source)).toAlignedRect();
+    if (source.isEmpty())
+        return true;
+
+    PixelKernels::rotate(surface->bits(), surface->bytesPerLine(), updated.x(), updated.y(),
+                         m_uprightSurface->constBits(), m_uprightSurface->bytesPerLine(),
+                         source.x(), source.y(), source.width(), source.height(),
+                         surface->depth() / 8, angle);
+
+    return true;
+}
+
+void CardWebApp::releaseUprightSurface()
+{
+    delete m_uprightSurface;
+    m_uprightSurface = 0;
+    m_uprightDirty = QRect();
+}
+
+int CardWebApp::releaseMemory()
+{
+    int bytes = WindowedWebApp::releaseMemory();
+    if (m_uprightSurface)
+        bytes += m_uprightSurface->byteCount();
+
+    // the next rotated paint renders the whole upright surface again
+    releaseUprightSurface();
+    return bytes;
+}
+
+bool CardWebApp::startRotateTransition(int angle)
+{
+    stopRotateTransition();
+
+    if (!m_rotateTransitions || angle % 360 == 0 || m_directRendering ||
+        m_childWebApp || !m_data || paintHeldBack() || !appLoaded())
+        return false;
+
+    QPainter* painter = m_data->qtRenderingContext();
+    if (!painter)
+        return false;
+
+    m_data->beginPaint();
+    QPaintDevice* device = painter->device();
+    if (device && device->devType() == QInternal::Image)
+        m_rotateTransition = new WebAppRotateTransition(*static_cast<QImage*>(device), angle,
+                                                        kRotateTransitionMs);
+    m_data->endPaint(false, QRect());
+
+    if (m_rotateTransition && !m_rotateTransition->isValid()) {
+        delete m_rotateTransition;
+        m_rotateTransition = 0;
+    }
+
+    if (!m_rotateTransition)
+        return false;
+
+    // the first frame goes out on the next tick, after the page got its new size
+    m_rotateTransitionTimer.start(kRotateTransitionFrameMs);
+    ThreadPriorityManager::instance()->hold(ThreadPriorityManager::Animation,
+                                            kRotateTransitionMs + kRotateTransitionFrameMs);
+    return true;
+}
+
+void CardWebApp::stopRotateTransition()
+{
+    m_rotateTransitionTimer.stop();
+    delete m_rotateTransition;
+    m_rotateTransition = 0;
+}
+
+bool CardWebApp::thumbnailStaleTick()
+{
+    // the buffer already holds the damage, only the thumbnail lags behind
+    if (m_thumbnail && m_data && m_thumbnail->needsUpdate())
+        m_thumbnail->update(m_data);
+
+    return false;
+}
+
+bool CardWebApp::rotateTransitionTick()
+{
+    if (!m_rotateTransition)
+        return false;
+
+    bool running = false;
+    if (!paintHeldBack()) {
+        QPainter* painter = m_data->qtRenderingContext();
+        m_data->beginPaint();
+        QPaintDevice* device = painter->device();
+        if (device && device->devType() == QInternal::Image)
+            running = m_rotateTransition->paintFrame(static_cast<QImage*>(device));
+        m_data->endPaint(false, QRect());
+    }
+
+    if (running) {
+        sendWindowUpdate(QRect(0, 0, m_appBufWidth, m_appBufHeight));
+        return true;
+    }
+
+    // swap in the real content, laid out by now
+    delete m_rotateTransition;
+    m_rotateTransition = 0;
+
+    invalidate();
+    return false;
+}
+
 int CardWebApp::resizeEvent(int newWidth, int newHeight, bool resizeBuffer)
 {
     // If we want to actually support resizing webapps on-the-fly to arbitrary sizes, we have to make sure
@@ -704,6 +964,8 @@ int CardWebApp::resizeEvent(int newWidth, int newHeight, bool resizeBuffer)
 	}
 
 	if(resizeBuffer) {
+		stopRotateTransition();
+		m_retainedFrame = false;
 		int oldKey = m_data->key();
 		m_data->resize(newWidth, newHeight);
 
@@ -770,6 +1032,8 @@ void CardWebApp::flipEvent(int newWidth, int newHeight)
 		return;
 	}
 
+	stopRotateTransition();
+	m_retainedFrame = false;
 	m_data->flip();
 
 	int tempWidth = m_width;
@@ -809,6 +1073,8 @@ void CardWebApp::asyncFlipEvent(int newWidth, int newHeight, int newScreenWidth,
 		return;
 	}
 
+	stopRotateTransition();
+	m_retainedFrame = false;
 	if (m_data)
 		m_data->flip();
 
@@ -938,6 +1204,11 @@ void CardWebApp::resizeWindowForOrientation(Event::Orientation orient)
 	}
 	}
 
+	// turn the last frame into place while the page relays out, rather than
+	// making the user wait for a full synchronous repaint
+	int currAngleForAnim = angleForOrientation(oldOrientation) - angleForOrientation(m_orientation);
+	bool animating = startRotateTransition(((-currAngleForAnim % 360) + 360) % 360);
+
 	int savedWindowWidth = m_windowWidth;
 	int savedWindowHeight = m_windowHeight;
 	m_windowWidth = m_appBufWidth;
@@ -951,33 +1222,12 @@ void CardWebApp::resizeWindowForOrientation(Event::Orientation orient)
 	else {
 		setVisibleDimensions(m_width, m_height);
 	}	
-	
-	// Force a full paint onto a temporary surface
-    QImage toSceneSurface(m_width, m_height, QImage::Format_ARGB32_Premultiplied);
-    QPainter toSceneContext;
 
-    forcePaint();
-    // Now we can kick off the animation
-	int currAngleForAnim = angleForOrientation(oldOrientation) - angleForOrientation(m_orientation);
-	if (currAngleForAnim > 180)
-		currAngleForAnim = -90;
-	else if (currAngleForAnim < -180)
-		currAngleForAnim = 90;
-	int targAngleForAnim = 0;
+	if (!animating)
+		forcePaint();
 
 	updateWindowProperties();
 
-    QPainter* gc = m_data->qtRenderingContext();
-
-//	WindowContentTransitionRunner::instance()->runRotateTransition(this,
-//																   toSceneSurface,
-//																   gc,
-//																   currAngleForAnim,
-//																   targAngleForAnim);
-
-//	toSceneSurface->releaseRef();
-//	toSceneContext->releaseRef();
-
 	if (savedWindowWidth != (int) m_windowWidth ||
 		savedWindowHeight != (int) m_windowHeight) {
 		m_windowWidth = savedWindowWidth;
@@ -995,8 +1245,6 @@ void CardWebApp::resizeWindowForOrientation(Event::Orientation orient)
 	}
 
 	m_channel->sendAsyncMessage(new ViewHost_Card_SetAppOrientation(routingId(), orient));
-	
-    //animationFinished();
 }
 
 void CardWebApp::resizeWindowForFixedOrientation(Event::Orientation orient)
@@ -1188,10 +1436,27 @@ void CardWebApp::invalContents(int x, int y, int width, int height)
     // should try to have a window surface that wraps around the ipc buffer
     // and just pass a widget with that surface as the viewport.
     invalidateScene(QRectF(x, y, width, height));
+    m_paintStats.damageAdded();
+    if (m_thumbnail)
+        m_thumbnail->damageAdded(width * height);
+    if (m_uprightSurface)
+        m_uprightDirty |= QRect(x, y, width, height);
+    if (m_tileCache) {
+        // tiles are in window buffer coordinates, the webview may be rotated
+        QRectF sceneRect = m_webview->mapRectToScene(QRectF(x, y, width, height));
+        m_tileCache->invalidate(mapFromScene(sceneRect).boundingRect().adjusted(-1, -1, 1, 1));
+    }
     // paint timer will call our overloaded ::paint from WindowedWebApp
     startPaintTimer();
 }
 
+void CardWebApp::scrollRect(int dx, int dy, const QRect& rectToScroll)
+{
+    // the buffer may be rotated or shared with a child card, and the upright
+    // copy, tiles and thumbnail follow damage: no blit, just repaint
+    invalContents(rectToScroll.x(), rectToScroll.y(), rectToScroll.width(), rectToScroll.height());
+}
+
 void CardWebApp::invalidate()
 {
     invalContents(0, 0, m_appBufWidth, m_appBufHeight);
@@ -1683,27 +1948,29 @@ void CardWebApp::directRenderingDisallowed()
 
 void CardWebApp::displayOn()
 {
-	if (!m_paintingDisabled)
+	if (!m_displayOff)
 		return;
 	
     qDebug() << (page() ? page()->appId() : QString("unknown")) << ":"
              << (page() ? page()->processId() : QString("unknown"))
              << " resuming paints";
 
-	m_paintingDisabled = false;
-    forcePaint();
+	// WebAppManager repaints us through repaintAfterDisplayOn(), foreground first
+	WindowedWebApp::displayOn();
 }
 
 void CardWebApp::displayOff()
 {
-	if (m_paintingDisabled)
+	if (m_displayOff)
 		return;
 
     qDebug() << (page() ? page()->appId() : QString("unknown")) << ":"
              << (page() ? page()->processId() : QString("unknown"))
              << " suspending paints";
 
-	m_paintingDisabled = true;
+	// a transition would keep its frame timer running for nobody
+	stopRotateTransition();
+	WindowedWebApp::displayOff();
 }
 
 Event::Orientation CardWebApp::orientationForThisCard(Event::Orientation orient)
@@ -1841,12 +2108,9 @@ void CardWebApp::thawFromCache()
 
 	// Resume all timers in the app before we do the rest of the thawing work
 	// which may indirectly rely on timers working.
-//	m_page->webkitPage()->throttle(100, 0);
+	page()->throttle()->setState(WebPageThrottle::Background);
 
 	WebAppCache::remove(this);
-	page()->page()->mainFrame()->evaluateJavaScript("if (window.Mojo && Mojo.show) Mojo.show()");
-
-    qDebug("THAWING app %s", page()->appId().toStdString().c_str());
 
 	if (m_fixedOrientation == Event::Orientation_Invalid) {
 		WebAppManager* wam = WebAppManager::instance();
@@ -1854,6 +2118,16 @@ void CardWebApp::thawFromCache()
 			m_height != wam->currentUiHeight())
 			flipEvent(wam->currentUiWidth(), wam->currentUiHeight());
 	}
+
+	// with the last frame still in the buffer the window can be shown before
+	// Mojo.show() runs and before anything is rendered
+	bool reuseFrame = m_retainedFrame;
+	m_retainedFrame = false;
+
+	if (!reuseFrame)
+		page()->events()->show();
+
+    qDebug("THAWING app %s%s", page()->appId().toStdString().c_str(), reuseFrame ? " with its last frame" : "");
 	
 	m_channel->sendAsyncMessage(new ViewHost_PrepareAddWindowWithMetaData(routingId(), metadataId(),
 																		  m_winType, m_width, m_height));		
@@ -1863,10 +2137,28 @@ void CardWebApp::thawFromCache()
 	m_channel->sendAsyncMessage(new ViewHost_SetLaunchingProcessId(routingId(), page()->launchingProcessId().toStdString().c_str()));
 	m_channel->sendAsyncMessage(new ViewHost_SetName(routingId(), page()->name().toStdString().c_str()));
 
-	
-	stagePreparing();
-	invalidate();
-	stageReady();    
+
+	if (reuseFrame) {
+		m_channel->sendAsyncMessage(new ViewHost_AddWindow(routingId()));
+		m_addedToWindowMgr = true;
+
+		// straight to the host, the content hash would call this unchanged
+		m_data->sendWindowUpdate(0, 0, m_appBufWidth, m_appBufHeight);
+
+		stagePreparing();
+		stageReady();
+
+		// whatever Mojo.show() and the time in the cache changed converges
+		// through normal damage paints
+		page()->events()->show();
+		if (!m_paintRect.isEmpty())
+			startPaintTimer();
+	}
+	else {
+		stagePreparing();
+		invalidate();
+		stageReady();
+	}
 
 	EventReporter::instance()->report("launch", page()->appId().toStdString().c_str());
 
@@ -1874,6 +2166,7 @@ void CardWebApp::thawFromCache()
 	setWindowProperties(m_winProps);
 
 	markInCache(false);
+	updateThrottleState();
 
 }
 
@@ -1886,13 +2179,23 @@ void CardWebApp::freezeInCache()
     if (m_winType == WindowType::Type_Card || m_winType == WindowType::Type_ChildCard)
 		WebAppDeferredUpdateHandler::unregisterApp(this);
 
+	// a complete frame stays in the buffer while the card is cached, unless it
+	// is mid transition or the host was drawing it directly
+	m_retainedFrame = m_data && m_addedToWindowMgr && !m_directRendering &&
+					  !m_childWebApp && !m_rotateTransition;
+	stopRotateTransition();
+
+	// the switcher keeps showing the thumbnail of the cached card
+	if (m_thumbnail)
+		m_thumbnail->update(m_data);
+
 	if (m_data)
 		m_channel->sendAsyncMessage(new ViewHost_RemoveWindow(routingId()));
 
 //	m_page->webkitView()->setSupportsAcceleratedCompositing(false);
 //	m_page->webkitView()->unmapCompositingTextures();
 
-	page()->page()->mainFrame()->evaluateJavaScript("if (window.Mojo && Mojo.hide) Mojo.hide()");
+	page()->events()->hide();
 	WebAppCache::put(this);
 
 	m_stagePreparing = false;
@@ -1901,11 +2204,11 @@ void CardWebApp::freezeInCache()
 
 	EventReporter::instance()->report("close", page()->appId().toStdString().c_str());
 
-	// Suspend all timers in the app after we finish the freezing work.
-//	m_page->webkitPage()->throttle(0, 0);
-
 	markInCache(true);
 
+	// Suspend all timers in the app after we finish the freezing work.
+	updateThrottleState();
+
 }
 
 void CardWebApp::focus()
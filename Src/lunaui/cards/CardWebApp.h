@@ -39,6 +39,7 @@ class QGraphicsScene;
 class QGraphicsWebView;
 class QGLWidget;
 class myGraphicsView;
+class WebAppRotateTransition;
 
 class CardWebApp : public WindowedWebApp, public QGraphicsView
 {
@@ -54,6 +55,7 @@ public:
 	virtual bool isChildApp() const;
 
     virtual void paint();
+    virtual void renderContents(QPainter* painter, const QRect& rect);
 
 
 	virtual void inputEvent(sptr<Event> e);
@@ -78,6 +80,7 @@ public:
 
 	virtual void displayOn();
 	virtual void displayOff();
+	virtual int releaseMemory();
 
 	void allowResizeOnPositiveSpaceChange(bool allowResize);
 
@@ -104,6 +107,7 @@ private:
 	void handlePendingChanges();
 	
     virtual void invalContents(int x, int y, int width, int height);
+    virtual void scrollRect(int dx, int dy, const QRect& rectToScroll);
 	virtual void loadFinished();
 
 	void callMojoScreenOrientationChange();
@@ -142,6 +146,20 @@ protected:
 */
     void applyCardOrientation();
 
+    // paints a rotated card by rendering upright into m_uprightSurface and
+    // rotating the damaged part into the window buffer. returns false if the
+    // webview isn't rotated by a multiple of 90 degrees
+    bool paintRotated(QPainter* painter, const QRect& requested, QRect& updated);
+    void releaseUprightSurface();
+
+    // crossfades the last frame into a copy turned clockwise by angle while the
+    // page relays out for a new orientation. paints are held back meanwhile
+    bool startRotateTransition(int angle);
+    void stopRotateTransition();
+    bool rotateTransitionTick();
+
+    bool thumbnailStaleTick();
+
 public:
 	virtual void suspendAppRendering();
 	virtual void resumeAppRendering();
@@ -190,13 +208,26 @@ protected:
 	int m_renderOffsetX;
 	int m_renderOffsetY;
     SysMgrEvent::Orientation m_renderOrientation;
-	bool m_paintingDisabled;
 
 	bool m_renderingSuspended;
 	
     QGraphicsWebView* m_webview;
     QGLWidget* m_glw;
     bool m_lastPaintIPCBuffer;
+
+    bool m_rotationBlit;
+    QImage* m_uprightSurface;
+    QRect m_uprightDirty;		// in webview coordinates
+
+    bool m_rotateTransitions;
+    WebAppRotateTransition* m_rotateTransition;
+    Timer<CardWebApp> m_rotateTransitionTimer;
+
+    // refreshes the thumbnail once small damage got stale without another paint
+    Timer<CardWebApp> m_thumbnailTimer;
+
+    // the buffer still holds the frame shown before the card went into the cache
+    bool m_retainedFrame;
 private:
 	
 	CardWebApp& operator=( const CardWebApp& );
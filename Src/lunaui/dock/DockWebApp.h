@@ -44,7 +44,6 @@ public:
 
 protected:
 	virtual void setVisibleDimensions(int width, int height);
-	void resizeWindowForOrientation(Event::Orientation orient);
 	
 private:
 	
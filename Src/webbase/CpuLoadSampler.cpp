@@ -0,0 +1,211 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "CpuLoadSampler.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ThreadPriorityManager.h"
+
+// weight of the newest interval in the moving averages, in 1/256th. about
+// the last two seconds count
+static const uint32_t kNewSampleWeight = 64;
+
+static uint32_t PrvMovingAverage(uint32_t average, uint32_t value, bool first)
+{
+	if (first)
+		return value;
+
+	return (average * (256 - kNewSampleWeight) + value * kNewSampleWeight + 128) / 256;
+}
+
+CpuLoadSampler* CpuLoadSampler::instance()
+{
+	static CpuLoadSampler* s_instance = 0;
+	if (G_UNLIKELY(s_instance == 0))
+		s_instance = new CpuLoadSampler;
+
+	return s_instance;
+}
+
+CpuLoadSampler::CpuLoadSampler()
+	: m_started(false)
+	, m_paused(false)
+	, m_lastTotal(0)
+	, m_lastIdle(0)
+	, m_lastProcess(0)
+	, m_rebased(false)
+	, m_systemLoad(0)
+	, m_processLoad(0)
+	, m_samples(0)
+{
+	pthread_mutex_init(&m_mutex, 0);
+	pthread_cond_init(&m_resumed, 0);
+}
+
+void CpuLoadSampler::start()
+{
+	if (m_started)
+		return;
+
+	readSystemTimes(m_lastTotal, m_lastIdle);
+	readProcessTime(m_lastProcess);
+
+	// the manager adjusts the thread that creates it, which has to be this one
+	ThreadPriorityManager::instance();
+
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+	pthread_t thread;
+	m_started = (pthread_create(&thread, &attr, CpuLoadSampler::threadMain, this) == 0);
+	pthread_attr_destroy(&attr);
+
+	if (!m_started)
+		g_warning("%s: failed to start the cpu load sampling thread", __PRETTY_FUNCTION__);
+}
+
+void CpuLoadSampler::setPaused(bool paused)
+{
+	pthread_mutex_lock(&m_mutex);
+	if (m_paused != paused) {
+		m_paused = paused;
+		g_debug("%s: cpu load sampling %s", __PRETTY_FUNCTION__, paused ? "paused" : "resumed");
+		if (!paused)
+			pthread_cond_signal(&m_resumed);
+	}
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void* CpuLoadSampler::threadMain(void* arg)
+{
+	CpuLoadSampler* sampler = static_cast<CpuLoadSampler*>(arg);
+
+	ThreadPriorityManager::instance()->registerThread();
+
+	while (true) {
+		usleep(kSampleIntervalMs * 1000);
+
+		bool waited = false;
+		pthread_mutex_lock(&sampler->m_mutex);
+		while (sampler->m_paused) {
+			pthread_cond_wait(&sampler->m_resumed, &sampler->m_mutex);
+			waited = true;
+		}
+		pthread_mutex_unlock(&sampler->m_mutex);
+
+		// the load while paused is of no interest, the next interval starts now
+		if (waited) {
+			readSystemTimes(sampler->m_lastTotal, sampler->m_lastIdle);
+			readProcessTime(sampler->m_lastProcess);
+			sampler->m_rebased = true;
+			continue;
+		}
+
+		sampler->sample();
+	}
+
+	return 0;
+}
+
+void CpuLoadSampler::sample()
+{
+	uint64_t total, idle, process;
+	if (!readSystemTimes(total, idle))
+		return;
+	if (!readProcessTime(process))
+		process = m_lastProcess;
+
+	uint64_t elapsed = total - m_lastTotal;
+	if (!elapsed)
+		return;
+
+	uint64_t busy = elapsed - MIN(idle - m_lastIdle, elapsed);
+	uint64_t used = MIN(process - m_lastProcess, elapsed);
+
+	m_lastTotal = total;
+	m_lastIdle = idle;
+	m_lastProcess = process;
+
+	bool first = (m_samples == 0) || m_rebased;
+	m_rebased = false;
+	m_systemLoad = PrvMovingAverage(m_systemLoad, (uint32_t) (busy * 1000 / elapsed), first);
+	m_processLoad = PrvMovingAverage(m_processLoad, (uint32_t) (used * 1000 / elapsed), first);
+
+	// the averages are published before anyone can see there is a sample
+	__sync_synchronize();
+	m_samples = m_samples + 1;
+}
+
+bool CpuLoadSampler::readSystemTimes(uint64_t& total, uint64_t& idle)
+{
+	FILE* f = fopen("/proc/stat", "rb");
+	if (!f)
+		return false;
+
+	// cpu user nice system idle iowait irq softirq steal
+	unsigned long long t[8] = { 0 };
+	int count = fscanf(f, "cpu %llu %llu %llu %llu %llu %llu %llu %llu",
+					   &t[0], &t[1], &t[2], &t[3], &t[4], &t[5], &t[6], &t[7]);
+	fclose(f);
+
+	if (count < 4)
+		return false;
+
+	total = 0;
+	for (int i = 0; i < count; i++)
+		total += t[i];
+
+	idle = t[3] + t[4];
+	return true;
+}
+
+bool CpuLoadSampler::readProcessTime(uint64_t& used)
+{
+	char buffer[1024];
+
+	FILE* f = fopen("/proc/self/stat", "rb");
+	if (!f)
+		return false;
+
+	size_t len = fread(buffer, 1, sizeof(buffer) - 1, f);
+	fclose(f);
+	buffer[len] = '\0';
+
+	// the command name may contain spaces, the fields after it don't. utime
+	// and stime are the 12th and 13th after the name
+	const char* p = strrchr(buffer, ')');
+	if (!p)
+		return false;
+
+	unsigned long utime, stime;
+	if (sscanf(p + 1, " %*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu", &utime, &stime) != 2)
+		return false;
+
+	used = (uint64_t) utime + stime;
+	return true;
+}
@@ -0,0 +1,100 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef CPULOADSAMPLER_H
+#define CPULOADSAMPLER_H
+
+#include "Common.h"
+
+#include <stdint.h>
+#include <pthread.h>
+
+/**
+ * Keeps track of how busy the system and this process are.
+ *
+ * A background thread reads /proc/stat and /proc/self/stat every
+ * kSampleIntervalMs and folds the load into moving averages. Reading them is
+ * a plain load of a word, so the main loop never waits for a sample.
+ *
+ * Sampling can be paused while nobody needs the load (the display is off and
+ * no gc pass is pending), so it doesn't wake the device up twice a second.
+ *
+ * Loads are per mille of all cpu time: 1000 means every cpu was busy.
+ */
+class CpuLoadSampler
+{
+public:
+
+	static CpuLoadSampler* instance();
+
+	// starts the sampling thread, call it from the main thread. Later calls do nothing
+	void start();
+
+	// a paused thread sleeps until resumed, then measures from that point on
+	void setPaused(bool paused);
+
+	// false until the first interval has been measured
+	bool hasSample() const { return m_samples > 0; }
+
+	// time the cpus weren't idle (or waiting for io). Until the first sample
+	// the system isn't known to be idle
+	unsigned systemLoad() const { return m_systemLoad; }
+	unsigned systemIdle() const { return hasSample() ? 1000 - m_systemLoad : 0; }
+
+	// time spent running this process
+	unsigned processLoad() const { return m_processLoad; }
+
+	static const int kSampleIntervalMs = 500;
+
+private:
+
+	CpuLoadSampler();
+
+	static void* threadMain(void* arg);
+	void sample();
+
+	static bool readSystemTimes(uint64_t& total, uint64_t& idle);
+	static bool readProcessTime(uint64_t& used);
+
+	bool m_started;
+
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_resumed;
+	bool m_paused;
+
+	// only touched by the sampling thread
+	uint64_t m_lastTotal;
+	uint64_t m_lastIdle;
+	uint64_t m_lastProcess;
+	bool m_rebased;		// the next sample replaces the averages
+
+	// written by the sampling thread, read by anyone
+	volatile uint32_t m_systemLoad;
+	volatile uint32_t m_processLoad;
+	volatile uint32_t m_samples;
+
+private:
+
+	CpuLoadSampler(const CpuLoadSampler&);
+	CpuLoadSampler& operator=(const CpuLoadSampler&);
+};
+
+#endif /* CPULOADSAMPLER_H */
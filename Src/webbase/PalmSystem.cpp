@@ -668,6 +668,13 @@ void PalmSystem::setWindowProperties(const QVariantMap& properties)
         props.setRotationLockMaximized (properties["rotationLockMaximized"].toBool());
     }
 
+    // opaque pages get a 16bpp window buffer. This never reaches the host as a
+    // window property, it is advertised through the window metadata instead
+    if (properties.contains("opaque") && properties["opaque"].type() == QVariant::Bool) {
+        if (app->isWindowed())
+            static_cast<WindowedWebApp*>(app)->setOpaqueSurface(properties["opaque"].toBool());
+    }
+
     WebAppManager::instance()->setAppWindowProperties(app->getKey(), props);
 }
 
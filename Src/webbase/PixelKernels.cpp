@@ -0,0 +1,1211 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "PixelKernels.h"
+
+#include <string.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+#define PIXELKERNELS_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+#define PIXELKERNELS_NEON 1
+#include <arm_neon.h>
+#endif
+
+typedef void (*FillRowFunc)(uint32_t* dst, int count, uint32_t value);
+typedef void (*CopyRowFunc)(uint32_t* dst, const uint32_t* src, int count);
+typedef void (*ReverseRow32Func)(uint32_t* dst, const uint32_t* src, int count);
+typedef void (*ReverseRow16Func)(uint16_t* dst, const uint16_t* src, int count);
+
+// transposes a square block: kTransposeBlock32 (4) pixels for 32bpp,
+// kTransposeBlock16 (8) for 16bpp. strides are in bytes and may be negative
+typedef void (*TransposeBlockFunc)(uint8_t* dst, int dstStride, const uint8_t* src, int srcStride);
+
+// averages factor x factor blocks of factor source rows into count 32bpp pixels
+typedef void (*DownscaleRowFunc)(uint32_t* dst, const uint8_t* src, int srcStride, int count, int factor);
+
+// dst = from * (256 - alpha) / 256 + to * alpha / 256, per channel
+typedef void (*CrossfadeRow32Func)(uint32_t* dst, const uint32_t* from, const uint32_t* to, int count, int alpha);
+typedef void (*CrossfadeRow16Func)(uint16_t* dst, const uint16_t* from, const uint16_t* to, int count, int alpha);
+
+static const int kTransposeBlock32 = 4;
+static const int kTransposeBlock16 = 8;
+
+struct PixelKernelImpl
+{
+	const char* name;
+	FillRowFunc fillRow;
+	CopyRowFunc copyRow;
+	TransposeBlockFunc transposeBlock32;
+	TransposeBlockFunc transposeBlock16;
+	ReverseRow32Func reverseRow32;
+	ReverseRow16Func reverseRow16;
+	DownscaleRowFunc downscaleRow32;
+	DownscaleRowFunc downscaleRow16;
+	CrossfadeRow32Func crossfadeRow32;
+	CrossfadeRow16Func crossfadeRow16;
+};
+
+// ------------------------------------------------------------------------------------------
+// Plain C
+
+static void PrvFillRowC(uint32_t* dst, int count, uint32_t value)
+{
+	if (value == 0) {
+		::memset(dst, 0, count * sizeof(uint32_t));
+		return;
+	}
+
+	while (count >= 4) {
+		dst[0] = value;
+		dst[1] = value;
+		dst[2] = value;
+		dst[3] = value;
+		dst += 4;
+		count -= 4;
+	}
+
+	while (count-- > 0)
+		*dst++ = value;
+}
+
+static void PrvCopyRowC(uint32_t* dst, const uint32_t* src, int count)
+{
+	::memcpy(dst, src, count * sizeof(uint32_t));
+}
+
+template <typename T>
+static inline void PrvTransposeC(uint8_t* dst, int dstStride, const uint8_t* src, int srcStride,
+								 int w, int h)
+{
+	for (int y = 0; y < h; y++) {
+		const T* s = reinterpret_cast<const T*>(src + y * srcStride);
+		for (int x = 0; x < w; x++)
+			reinterpret_cast<T*>(dst + x * dstStride)[y] = s[x];
+	}
+}
+
+static void PrvTransposeBlock32C(uint8_t* dst, int dstStride, const uint8_t* src, int srcStride)
+{
+	PrvTransposeC<uint32_t>(dst, dstStride, src, srcStride, kTransposeBlock32, kTransposeBlock32);
+}
+
+static void PrvTransposeBlock16C(uint8_t* dst, int dstStride, const uint8_t* src, int srcStride)
+{
+	PrvTransposeC<uint16_t>(dst, dstStride, src, srcStride, kTransposeBlock16, kTransposeBlock16);
+}
+
+static void PrvReverseRow32C(uint32_t* dst, const uint32_t* src, int count)
+{
+	src += count;
+	while (count-- > 0)
+		*dst++ = *--src;
+}
+
+static void PrvReverseRow16C(uint16_t* dst, const uint16_t* src, int count)
+{
+	src += count;
+	while (count-- > 0)
+		*dst++ = *--src;
+}
+
+static inline int PrvLog2(int factor)
+{
+	return factor == 2 ? 1 : (factor == 4 ? 2 : 3);
+}
+
+static void PrvDownscaleRow32C(uint32_t* dst, const uint8_t* src, int srcStride, int count, int factor)
+{
+	const int shift = 2 * PrvLog2(factor);
+	const uint32_t round = 1 << (shift - 1);
+
+	for (int i = 0; i < count; i++) {
+		uint32_t sums[4] = { 0, 0, 0, 0 };
+		const uint8_t* block = src + i * factor * sizeof(uint32_t);
+
+		for (int y = 0; y < factor; y++) {
+			const uint8_t* p = block + y * srcStride;
+			for (int x = 0; x < factor * (int) sizeof(uint32_t); x += sizeof(uint32_t)) {
+				sums[0] += p[x];
+				sums[1] += p[x + 1];
+				sums[2] += p[x + 2];
+				sums[3] += p[x + 3];
+			}
+		}
+
+		uint8_t* out = reinterpret_cast<uint8_t*>(dst + i);
+		for (int c = 0; c < 4; c++)
+			out[c] = (sums[c] + round) >> shift;
+	}
+}
+
+// average 5/6 bit channel sums of n pixels into an opaque 32bpp pixel
+static inline uint32_t PrvPackRgb565Sums(uint32_t r, uint32_t g, uint32_t b, int n)
+{
+	r = (r * 255 + n * 31 / 2) / (n * 31);
+	g = (g * 255 + n * 63 / 2) / (n * 63);
+	b = (b * 255 + n * 31 / 2) / (n * 31);
+	return 0xFF000000 | (r << 16) | (g << 8) | b;
+}
+
+static void PrvDownscaleRow16C(uint32_t* dst, const uint8_t* src, int srcStride, int count, int factor)
+{
+	for (int i = 0; i < count; i++) {
+		uint32_t r = 0;
+		uint32_t g = 0;
+		uint32_t b = 0;
+		const uint8_t* block = src + i * factor * sizeof(uint16_t);
+
+		for (int y = 0; y < factor; y++) {
+			const uint16_t* p = reinterpret_cast<const uint16_t*>(block + y * srcStride);
+			for (int x = 0; x < factor; x++) {
+				r += p[x] >> 11;
+				g += (p[x] >> 5) & 0x3F;
+				b += p[x] & 0x1F;
+			}
+		}
+
+		dst[i] = PrvPackRgb565Sums(r, g, b, factor * factor);
+	}
+}
+
+static void PrvCrossfadeRow32C(uint32_t* dst, const uint32_t* from, const uint32_t* to, int count, int alpha)
+{
+	const uint32_t beta = 256 - alpha;
+
+	for (int i = 0; i < count; i++) {
+		// two channels at a time, 8 bits of headroom each
+		uint32_t rb = ((from[i] & 0x00FF00FF) * beta + (to[i] & 0x00FF00FF) * alpha) >> 8;
+		uint32_t ag = ((from[i] >> 8) & 0x00FF00FF) * beta + ((to[i] >> 8) & 0x00FF00FF) * alpha;
+		dst[i] = (rb & 0x00FF00FF) | (ag & 0xFF00FF00);
+	}
+}
+
+static void PrvCrossfadeRow16C(uint16_t* dst, const uint16_t* from, const uint16_t* to, int count, int alpha)
+{
+	// 5 bit weights keep the 565 channels apart in 32 bits
+	const uint32_t a = alpha >> 3;
+	const uint32_t b = 32 - a;
+
+	for (int i = 0; i < count; i++) {
+		uint32_t f = (from[i] | (from[i] << 16)) & 0x07E0F81F;
+		uint32_t t = (to[i] | (to[i] << 16)) & 0x07E0F81F;
+		uint32_t v = ((f * b + t * a) >> 5) & 0x07E0F81F;
+		dst[i] = v | (v >> 16);
+	}
+}
+
+static const PixelKernelImpl s_implC = {
+	"c", PrvFillRowC, PrvCopyRowC,
+	PrvTransposeBlock32C, PrvTransposeBlock16C, PrvReverseRow32C, PrvReverseRow16C,
+	PrvDownscaleRow32C, PrvDownscaleRow16C,
+	PrvCrossfadeRow32C, PrvCrossfadeRow16C
+};
+
+// ------------------------------------------------------------------------------------------
+// SSE2 / AVX2
+
+#if defined(PIXELKERNELS_X86)
+
+__attribute__((target("sse2")))
+static void PrvFillRowSSE2(uint32_t* dst, int count, uint32_t value)
+{
+	// align the destination to 16 bytes
+	while (count > 0 && (reinterpret_cast<uintptr_t>(dst) & 15)) {
+		*dst++ = value;
+		count--;
+	}
+
+	const __m128i v = _mm_set1_epi32(value);
+	while (count >= 16) {
+		_mm_store_si128(reinterpret_cast<__m128i*>(dst) + 0, v);
+		_mm_store_si128(reinterpret_cast<__m128i*>(dst) + 1, v);
+		_mm_store_si128(reinterpret_cast<__m128i*>(dst) + 2, v);
+		_mm_store_si128(reinterpret_cast<__m128i*>(dst) + 3, v);
+		dst += 16;
+		count -= 16;
+	}
+
+	while (count >= 4) {
+		_mm_store_si128(reinterpret_cast<__m128i*>(dst), v);
+		dst += 4;
+		count -= 4;
+	}
+
+	while (count-- > 0)
+		*dst++ = value;
+}
+
+__attribute__((target("sse2")))
+static void PrvCopyRowSSE2(uint32_t* dst, const uint32_t* src, int count)
+{
+	while (count > 0 && (reinterpret_cast<uintptr_t>(dst) & 15)) {
+		*dst++ = *src++;
+		count--;
+	}
+
+	while (count >= 16) {
+		__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src) + 0);
+		__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src) + 1);
+		__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src) + 2);
+		__m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src) + 3);
+		_mm_store_si128(reinterpret_cast<__m128i*>(dst) + 0, a);
+		_mm_store_si128(reinterpret_cast<__m128i*>(dst) + 1, b);
+		_mm_store_si128(reinterpret_cast<__m128i*>(dst) + 2, c);
+		_mm_store_si128(reinterpret_cast<__m128i*>(dst) + 3, d);
+		dst += 16;
+		src += 16;
+		count -= 16;
+	}
+
+	while (count >= 4) {
+		_mm_store_si128(reinterpret_cast<__m128i*>(dst),
+						_mm_loadu_si128(reinterpret_cast<const __m128i*>(src)));
+		dst += 4;
+		src += 4;
+		count -= 4;
+	}
+
+	while (count-- > 0)
+		*dst++ = *src++;
+}
+
+__attribute__((target("sse2")))
+static void PrvTransposeBlock32SSE2(uint8_t* dst, int dstStride, const uint8_t* src, int srcStride)
+{
+	__m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+	__m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + srcStride));
+	__m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * srcStride));
+	__m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3 * srcStride));
+
+	__m128i t0 = _mm_unpacklo_epi32(r0, r1);
+	__m128i t1 = _mm_unpacklo_epi32(r2, r3);
+	__m128i t2 = _mm_unpackhi_epi32(r0, r1);
+	__m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_unpacklo_epi64(t0, t1));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + dstStride), _mm_unpackhi_epi64(t0, t1));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * dstStride), _mm_unpacklo_epi64(t2, t3));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 3 * dstStride), _mm_unpackhi_epi64(t2, t3));
+}
+
+__attribute__((target("sse2")))
+static void PrvTransposeBlock16SSE2(uint8_t* dst, int dstStride, const uint8_t* src, int srcStride)
+{
+	__m128i r[8];
+	for (int i = 0; i < 8; i++)
+		r[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * srcStride));
+
+	__m128i t[8];
+	for (int i = 0; i < 4; i++) {
+		t[2 * i] = _mm_unpacklo_epi16(r[2 * i], r[2 * i + 1]);
+		t[2 * i + 1] = _mm_unpackhi_epi16(r[2 * i], r[2 * i + 1]);
+	}
+
+	__m128i u[8];
+	u[0] = _mm_unpacklo_epi32(t[0], t[2]);
+	u[1] = _mm_unpackhi_epi32(t[0], t[2]);
+	u[2] = _mm_unpacklo_epi32(t[1], t[3]);
+	u[3] = _mm_unpackhi_epi32(t[1], t[3]);
+	u[4] = _mm_unpacklo_epi32(t[4], t[6]);
+	u[5] = _mm_unpackhi_epi32(t[4], t[6]);
+	u[6] = _mm_unpacklo_epi32(t[5], t[7]);
+	u[7] = _mm_unpackhi_epi32(t[5], t[7]);
+
+	for (int i = 0; i < 4; i++) {
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i * dstStride),
+						 _mm_unpacklo_epi64(u[i], u[i + 4]));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + (2 * i + 1) * dstStride),
+						 _mm_unpackhi_epi64(u[i], u[i + 4]));
+	}
+}
+
+__attribute__((target("sse2")))
+static void PrvReverseRow32SSE2(uint32_t* dst, const uint32_t* src, int count)
+{
+	src += count;
+	while (count >= 4) {
+		src -= 4;
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_shuffle_epi32(v, 0x1B));
+		dst += 4;
+		count -= 4;
+	}
+
+	while (count-- > 0)
+		*dst++ = *--src;
+}
+
+__attribute__((target("sse2")))
+static void PrvReverseRow16SSE2(uint16_t* dst, const uint16_t* src, int count)
+{
+	src += count;
+	while (count >= 8) {
+		src -= 8;
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+		v = _mm_shufflelo_epi16(v, 0x1B);
+		v = _mm_shufflehi_epi16(v, 0x1B);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_shuffle_epi32(v, 0x4E));
+		dst += 8;
+		count -= 8;
+	}
+
+	while (count-- > 0)
+		*dst++ = *--src;
+}
+
+__attribute__((target("sse2")))
+static void PrvDownscaleRow32SSE2(uint32_t* dst, const uint8_t* src, int srcStride, int count, int factor)
+{
+	const int shift = 2 * PrvLog2(factor);
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i round = _mm_set1_epi16(1 << (shift - 1));
+	const __m128i count16 = _mm_cvtsi32_si128(shift);
+
+	for (int i = 0; i < count; i++) {
+		// 16 bit lanes: the channels of the even and the odd source pixels
+		__m128i acc = zero;
+		const uint8_t* block = src + i * factor * sizeof(uint32_t);
+
+		for (int y = 0; y < factor; y++) {
+			const uint8_t* p = block + y * srcStride;
+			int x = 0;
+			for (; x + 4 <= factor; x += 4) {
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + x * sizeof(uint32_t)));
+				acc = _mm_add_epi16(acc, _mm_unpacklo_epi8(v, zero));
+				acc = _mm_add_epi16(acc, _mm_unpackhi_epi8(v, zero));
+			}
+			for (; x < factor; x += 2) {
+				__m128i v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(p + x * sizeof(uint32_t)));
+				acc = _mm_add_epi16(acc, _mm_unpacklo_epi8(v, zero));
+			}
+		}
+
+		acc = _mm_add_epi16(acc, _mm_srli_si128(acc, 8));
+		acc = _mm_srl_epi16(_mm_add_epi16(acc, round), count16);
+		dst[i] = _mm_cvtsi128_si32(_mm_packus_epi16(acc, acc));
+	}
+}
+
+__attribute__((target("sse2")))
+static void PrvDownscaleRow16SSE2(uint32_t* dst, const uint8_t* src, int srcStride, int count, int factor)
+{
+	const __m128i mask5 = _mm_set1_epi16(0x1F);
+	const __m128i mask6 = _mm_set1_epi16(0x3F);
+	const __m128i ones = _mm_set1_epi16(1);
+
+	// every load covers 8 source pixels, that is 8 / factor output pixels
+	const int perLoad = 8 / factor;
+	const int laneStep = factor / 2;
+
+	int i = 0;
+	for (; i + perLoad <= count; i += perLoad) {
+		__m128i r = _mm_setzero_si128();
+		__m128i g = _mm_setzero_si128();
+		__m128i b = _mm_setzero_si128();
+		const uint8_t* p = src + i * factor * sizeof(uint16_t);
+
+		for (int y = 0; y < factor; y++, p += srcStride) {
+			__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+			r = _mm_add_epi16(r, _mm_srli_epi16(v, 11));
+			g = _mm_add_epi16(g, _mm_and_si128(_mm_srli_epi16(v, 5), mask6));
+			b = _mm_add_epi16(b, _mm_and_si128(v, mask5));
+		}
+
+		// sum neighbouring columns into 32 bit lanes until one lane holds a block
+		r = _mm_madd_epi16(r, ones);
+		g = _mm_madd_epi16(g, ones);
+		b = _mm_madd_epi16(b, ones);
+		if (factor >= 4) {
+			r = _mm_add_epi32(r, _mm_shuffle_epi32(r, 0xB1));
+			g = _mm_add_epi32(g, _mm_shuffle_epi32(g, 0xB1));
+			b = _mm_add_epi32(b, _mm_shuffle_epi32(b, 0xB1));
+		}
+		if (factor == 8) {
+			r = _mm_add_epi32(r, _mm_shuffle_epi32(r, 0x4E));
+			g = _mm_add_epi32(g, _mm_shuffle_epi32(g, 0x4E));
+			b = _mm_add_epi32(b, _mm_shuffle_epi32(b, 0x4E));
+		}
+
+		uint32_t rs[4];
+		uint32_t gs[4];
+		uint32_t bs[4];
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(rs), r);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(gs), g);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(bs), b);
+
+		for (int k = 0; k < perLoad; k++)
+			dst[i + k] = PrvPackRgb565Sums(rs[k * laneStep], gs[k * laneStep], bs[k * laneStep], factor * factor);
+	}
+
+	if (i < count)
+		PrvDownscaleRow16C(dst + i, src + i * factor * sizeof(uint16_t), srcStride, count - i, factor);
+}
+
+__attribute__((target("sse2")))
+static void PrvCrossfadeRow32SSE2(uint32_t* dst, const uint32_t* from, const uint32_t* to, int count, int alpha)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i a = _mm_set1_epi16(alpha);
+	const __m128i b = _mm_set1_epi16(256 - alpha);
+
+	int i = 0;
+	for (; i + 4 <= count; i += 4) {
+		__m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i));
+		__m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(to + i));
+
+		// 255 * 256 still fits the unsigned 16 bit lanes
+		__m128i lo = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(f, zero), b),
+								   _mm_mullo_epi16(_mm_unpacklo_epi8(t, zero), a));
+		__m128i hi = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(f, zero), b),
+								   _mm_mullo_epi16(_mm_unpackhi_epi8(t, zero), a));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i),
+						 _mm_packus_epi16(_mm_srli_epi16(lo, 8), _mm_srli_epi16(hi, 8)));
+	}
+
+	if (i < count)
+		PrvCrossfadeRow32C(dst + i, from + i, to + i, count - i, alpha);
+}
+
+__attribute__((target("sse2")))
+static void PrvCrossfadeRow16SSE2(uint16_t* dst, const uint16_t* from, const uint16_t* to, int count, int alpha)
+{
+	const __m128i a = _mm_set1_epi16(alpha >> 3);
+	const __m128i b = _mm_set1_epi16(32 - (alpha >> 3));
+	const __m128i mask5 = _mm_set1_epi16(0x1F);
+	const __m128i mask6 = _mm_set1_epi16(0x3F);
+
+	int i = 0;
+	for (; i + 8 <= count; i += 8) {
+		__m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from + i));
+		__m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(to + i));
+
+		__m128i r = _mm_add_epi16(_mm_mullo_epi16(_mm_srli_epi16(f, 11), b),
+								  _mm_mullo_epi16(_mm_srli_epi16(t, 11), a));
+		__m128i g = _mm_add_epi16(_mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(f, 5), mask6), b),
+								  _mm_mullo_epi16(_mm_and_si128(_mm_srli_epi16(t, 5), mask6), a));
+		__m128i bl = _mm_add_epi16(_mm_mullo_epi16(_mm_and_si128(f, mask5), b),
+								   _mm_mullo_epi16(_mm_and_si128(t, mask5), a));
+
+		__m128i v = _mm_or_si128(_mm_slli_epi16(_mm_srli_epi16(r, 5), 11),
+								 _mm_or_si128(_mm_slli_epi16(_mm_srli_epi16(g, 5), 5),
+											  _mm_srli_epi16(bl, 5)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+	}
+
+	if (i < count)
+		PrvCrossfadeRow16C(dst + i, from + i, to + i, count - i, alpha);
+}
+
+__attribute__((target("avx2")))
+static void PrvFillRowAVX2(uint32_t* dst, int count, uint32_t value)
+{
+	while (count > 0 && (reinterpret_cast<uintptr_t>(dst) & 31)) {
+		*dst++ = value;
+		count--;
+	}
+
+	const __m256i v = _mm256_set1_epi32(value);
+	while (count >= 32) {
+		_mm256_store_si256(reinterpret_cast<__m256i*>(dst) + 0, v);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(dst) + 1, v);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(dst) + 2, v);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(dst) + 3, v);
+		dst += 32;
+		count -= 32;
+	}
+
+	while (count >= 8) {
+		_mm256_store_si256(reinterpret_cast<__m256i*>(dst), v);
+		dst += 8;
+		count -= 8;
+	}
+
+	while (count-- > 0)
+		*dst++ = value;
+}
+
+__attribute__((target("avx2")))
+static void PrvCopyRowAVX2(uint32_t* dst, const uint32_t* src, int count)
+{
+	while (count > 0 && (reinterpret_cast<uintptr_t>(dst) & 31)) {
+		*dst++ = *src++;
+		count--;
+	}
+
+	while (count >= 32) {
+		__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src) + 0);
+		__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src) + 1);
+		__m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src) + 2);
+		__m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src) + 3);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(dst) + 0, a);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(dst) + 1, b);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(dst) + 2, c);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(dst) + 3, d);
+		dst += 32;
+		src += 32;
+		count -= 32;
+	}
+
+	while (count >= 8) {
+		_mm256_store_si256(reinterpret_cast<__m256i*>(dst),
+						   _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src)));
+		dst += 8;
+		src += 8;
+		count -= 8;
+	}
+
+	while (count-- > 0)
+		*dst++ = *src++;
+}
+
+static const PixelKernelImpl s_implSSE2 = {
+	"sse2", PrvFillRowSSE2, PrvCopyRowSSE2,
+	PrvTransposeBlock32SSE2, PrvTransposeBlock16SSE2, PrvReverseRow32SSE2, PrvReverseRow16SSE2,
+	PrvDownscaleRow32SSE2, PrvDownscaleRow16SSE2,
+	PrvCrossfadeRow32SSE2, PrvCrossfadeRow16SSE2
+};
+
+// rotation is bound by the scattered stores and downscaling by the loads, wider
+// registers don't buy anything there
+static const PixelKernelImpl s_implAVX2 = {
+	"avx2", PrvFillRowAVX2, PrvCopyRowAVX2,
+	PrvTransposeBlock32SSE2, PrvTransposeBlock16SSE2, PrvReverseRow32SSE2, PrvReverseRow16SSE2,
+	PrvDownscaleRow32SSE2, PrvDownscaleRow16SSE2,
+	PrvCrossfadeRow32SSE2, PrvCrossfadeRow16SSE2
+};
+
+#endif // PIXELKERNELS_X86
+
+// ------------------------------------------------------------------------------------------
+// NEON
+
+#if defined(PIXELKERNELS_NEON)
+
+static void PrvFillRowNEON(uint32_t* dst, int count, uint32_t value)
+{
+	const uint32x4_t v = vdupq_n_u32(value);
+	while (count >= 16) {
+		vst1q_u32(dst + 0, v);
+		vst1q_u32(dst + 4, v);
+		vst1q_u32(dst + 8, v);
+		vst1q_u32(dst + 12, v);
+		dst += 16;
+		count -= 16;
+	}
+
+	while (count >= 4) {
+		vst1q_u32(dst, v);
+		dst += 4;
+		count -= 4;
+	}
+
+	while (count-- > 0)
+		*dst++ = value;
+}
+
+static void PrvCopyRowNEON(uint32_t* dst, const uint32_t* src, int count)
+{
+	while (count >= 16) {
+		uint32x4_t a = vld1q_u32(src + 0);
+		uint32x4_t b = vld1q_u32(src + 4);
+		uint32x4_t c = vld1q_u32(src + 8);
+		uint32x4_t d = vld1q_u32(src + 12);
+		vst1q_u32(dst + 0, a);
+		vst1q_u32(dst + 4, b);
+		vst1q_u32(dst + 8, c);
+		vst1q_u32(dst + 12, d);
+		dst += 16;
+		src += 16;
+		count -= 16;
+	}
+
+	while (count >= 4) {
+		vst1q_u32(dst, vld1q_u32(src));
+		dst += 4;
+		src += 4;
+		count -= 4;
+	}
+
+	while (count-- > 0)
+		*dst++ = *src++;
+}
+
+static void PrvTransposeBlock32NEON(uint8_t* dst, int dstStride, const uint8_t* src, int srcStride)
+{
+	uint32x4_t r0 = vld1q_u32(reinterpret_cast<const uint32_t*>(src));
+	uint32x4_t r1 = vld1q_u32(reinterpret_cast<const uint32_t*>(src + srcStride));
+	uint32x4_t r2 = vld1q_u32(reinterpret_cast<const uint32_t*>(src + 2 * srcStride));
+	uint32x4_t r3 = vld1q_u32(reinterpret_cast<const uint32_t*>(src + 3 * srcStride));
+
+	uint32x4x2_t t01 = vtrnq_u32(r0, r1);
+	uint32x4x2_t t23 = vtrnq_u32(r2, r3);
+
+	vst1q_u32(reinterpret_cast<uint32_t*>(dst),
+			  vcombine_u32(vget_low_u32(t01.val[0]), vget_low_u32(t23.val[0])));
+	vst1q_u32(reinterpret_cast<uint32_t*>(dst + dstStride),
+			  vcombine_u32(vget_low_u32(t01.val[1]), vget_low_u32(t23.val[1])));
+	vst1q_u32(reinterpret_cast<uint32_t*>(dst + 2 * dstStride),
+			  vcombine_u32(vget_high_u32(t01.val[0]), vget_high_u32(t23.val[0])));
+	vst1q_u32(reinterpret_cast<uint32_t*>(dst + 3 * dstStride),
+			  vcombine_u32(vget_high_u32(t01.val[1]), vget_high_u32(t23.val[1])));
+}
+
+static inline void PrvTransposeQuad16NEON(uint8_t* dst, int dstStride, const uint8_t* src, int srcStride)
+{
+	uint16x4_t r0 = vld1_u16(reinterpret_cast<const uint16_t*>(src));
+	uint16x4_t r1 = vld1_u16(reinterpret_cast<const uint16_t*>(src + srcStride));
+	uint16x4_t r2 = vld1_u16(reinterpret_cast<const uint16_t*>(src + 2 * srcStride));
+	uint16x4_t r3 = vld1_u16(reinterpret_cast<const uint16_t*>(src + 3 * srcStride));
+
+	uint16x4x2_t t01 = vtrn_u16(r0, r1);
+	uint16x4x2_t t23 = vtrn_u16(r2, r3);
+	uint32x2x2_t u0 = vtrn_u32(vreinterpret_u32_u16(t01.val[0]), vreinterpret_u32_u16(t23.val[0]));
+	uint32x2x2_t u1 = vtrn_u32(vreinterpret_u32_u16(t01.val[1]), vreinterpret_u32_u16(t23.val[1]));
+
+	vst1_u16(reinterpret_cast<uint16_t*>(dst), vreinterpret_u16_u32(u0.val[0]));
+	vst1_u16(reinterpret_cast<uint16_t*>(dst + dstStride), vreinterpret_u16_u32(u1.val[0]));
+	vst1_u16(reinterpret_cast<uint16_t*>(dst + 2 * dstStride), vreinterpret_u16_u32(u0.val[1]));
+	vst1_u16(reinterpret_cast<uint16_t*>(dst + 3 * dstStride), vreinterpret_u16_u32(u1.val[1]));
+}
+
+static void PrvTransposeBlock16NEON(uint8_t* dst, int dstStride, const uint8_t* src, int srcStride)
+{
+	// four 4x4 quads, the off diagonal ones swap places
+	PrvTransposeQuad16NEON(dst, dstStride, src, srcStride);
+	PrvTransposeQuad16NEON(dst + 4 * dstStride, dstStride, src + 4 * sizeof(uint16_t), srcStride);
+	PrvTransposeQuad16NEON(dst + 4 * sizeof(uint16_t), dstStride, src + 4 * srcStride, srcStride);
+	PrvTransposeQuad16NEON(dst + 4 * dstStride + 4 * sizeof(uint16_t), dstStride,
+						   src + 4 * srcStride + 4 * sizeof(uint16_t), srcStride);
+}
+
+static void PrvReverseRow32NEON(uint32_t* dst, const uint32_t* src, int count)
+{
+	src += count;
+	while (count >= 4) {
+		src -= 4;
+		uint32x4_t v = vrev64q_u32(vld1q_u32(src));
+		vst1q_u32(dst, vcombine_u32(vget_high_u32(v), vget_low_u32(v)));
+		dst += 4;
+		count -= 4;
+	}
+
+	while (count-- > 0)
+		*dst++ = *--src;
+}
+
+static void PrvReverseRow16NEON(uint16_t* dst, const uint16_t* src, int count)
+{
+	src += count;
+	while (count >= 8) {
+		src -= 8;
+		uint16x8_t v = vrev64q_u16(vld1q_u16(src));
+		vst1q_u16(dst, vcombine_u16(vget_high_u16(v), vget_low_u16(v)));
+		dst += 8;
+		count -= 8;
+	}
+
+	while (count-- > 0)
+		*dst++ = *--src;
+}
+
+static void PrvDownscaleRow32NEON(uint32_t* dst, const uint8_t* src, int srcStride, int count, int factor)
+{
+	const int16x4_t shift = vdup_n_s16(-2 * PrvLog2(factor));
+
+	for (int i = 0; i < count; i++) {
+		// 16 bit lanes: the channels of the even and the odd source pixels
+		uint16x8_t acc = vdupq_n_u16(0);
+		const uint8_t* block = src + i * factor * sizeof(uint32_t);
+
+		for (int y = 0; y < factor; y++) {
+			const uint8_t* p = block + y * srcStride;
+			for (int x = 0; x < factor; x += 2)
+				acc = vaddw_u8(acc, vld1_u8(p + x * sizeof(uint32_t)));
+		}
+
+		uint16x4_t sums = vrshl_u16(vadd_u16(vget_low_u16(acc), vget_high_u16(acc)), shift);
+		uint8x8_t pixel = vmovn_u16(vcombine_u16(sums, sums));
+		dst[i] = vget_lane_u32(vreinterpret_u32_u8(pixel), 0);
+	}
+}
+
+static void PrvCrossfadeRow32NEON(uint32_t* dst, const uint32_t* from, const uint32_t* to, int count, int alpha)
+{
+	const uint16x8_t a = vdupq_n_u16(alpha);
+	const uint16x8_t b = vdupq_n_u16(256 - alpha);
+
+	int i = 0;
+	for (; i + 2 <= count; i += 2) {
+		uint16x8_t f = vmovl_u8(vld1_u8(reinterpret_cast<const uint8_t*>(from + i)));
+		uint16x8_t t = vmovl_u8(vld1_u8(reinterpret_cast<const uint8_t*>(to + i)));
+		uint16x8_t v = vmlaq_u16(vmulq_u16(f, b), t, a);
+		vst1_u8(reinterpret_cast<uint8_t*>(dst + i), vshrn_n_u16(v, 8));
+	}
+
+	if (i < count)
+		PrvCrossfadeRow32C(dst + i, from + i, to + i, count - i, alpha);
+}
+
+static const PixelKernelImpl s_implNEON = {
+	"neon", PrvFillRowNEON, PrvCopyRowNEON,
+	PrvTransposeBlock32NEON, PrvTransposeBlock16NEON, PrvReverseRow32NEON, PrvReverseRow16NEON,
+	PrvDownscaleRow32NEON, PrvDownscaleRow16C,
+	PrvCrossfadeRow32NEON, PrvCrossfadeRow16C
+};
+
+#endif // PIXELKERNELS_NEON
+
+// ------------------------------------------------------------------------------------------
+// Dispatch
+
+static const PixelKernelImpl* const s_impls[] = {
+#if defined(PIXELKERNELS_X86)
+	&s_implAVX2,
+	&s_implSSE2,
+#endif
+#if defined(PIXELKERNELS_NEON)
+	&s_implNEON,
+#endif
+	&s_implC
+};
+
+static const PixelKernelImpl* s_impl = 0;
+
+static bool PrvCpuSupports(const PixelKernelImpl* impl)
+{
+	if (impl == &s_implC)
+		return true;
+
+#if defined(PIXELKERNELS_X86)
+	__builtin_cpu_init();
+	if (impl == &s_implSSE2)
+		return __builtin_cpu_supports("sse2");
+	if (impl == &s_implAVX2)
+		return __builtin_cpu_supports("avx2");
+#endif
+
+#if defined(PIXELKERNELS_NEON)
+	if (impl == &s_implNEON)
+		return true;
+#endif
+
+	return false;
+}
+
+static const PixelKernelImpl* PrvImpl()
+{
+	if (G_LIKELY(s_impl))
+		return s_impl;
+
+	// s_impls is ordered fastest first
+	for (unsigned int i = 0; i < G_N_ELEMENTS(s_impls); i++) {
+		if (PrvCpuSupports(s_impls[i])) {
+			s_impl = s_impls[i];
+			break;
+		}
+	}
+
+	g_debug("PixelKernels: using %s implementation", s_impl->name);
+	return s_impl;
+}
+
+static inline uint32_t* PrvPixelAt(void* base, int stride, int x, int y)
+{
+	return reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(base) + y * stride) + x;
+}
+
+static inline const uint32_t* PrvPixelAt(const void* base, int stride, int x, int y)
+{
+	return reinterpret_cast<const uint32_t*>(static_cast<const uint8_t*>(base) + y * stride) + x;
+}
+
+void PixelKernels::fill(void* dst, int stride, int x, int y, int w, int h, uint32_t value)
+{
+	if (w <= 0 || h <= 0)
+		return;
+
+	const PixelKernelImpl* impl = PrvImpl();
+	uint32_t* row = PrvPixelAt(dst, stride, x, y);
+
+	// rows that span the full stride are contiguous: do them in one go
+	if (w * (int) sizeof(uint32_t) == stride) {
+		impl->fillRow(row, w * h, value);
+		return;
+	}
+
+	for (int i = 0; i < h; i++) {
+		impl->fillRow(row, w, value);
+		row = reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(row) + stride);
+	}
+}
+
+void PixelKernels::fill16(void* dst, int stride, int x, int y, int w, int h, uint16_t value)
+{
+	if (w <= 0 || h <= 0)
+		return;
+
+	const PixelKernelImpl* impl = PrvImpl();
+	const uint32_t pair = ((uint32_t) value << 16) | value;
+	uint8_t* row = static_cast<uint8_t*>(dst) + y * stride + x * sizeof(uint16_t);
+
+	for (int i = 0; i < h; i++) {
+		uint16_t* p = reinterpret_cast<uint16_t*>(row);
+		int count = w;
+
+		// a leading odd pixel keeps the 32bpp kernel on a 4 byte boundary
+		if (reinterpret_cast<uintptr_t>(p) & 2) {
+			*p++ = value;
+			count--;
+		}
+
+		impl->fillRow(reinterpret_cast<uint32_t*>(p), count / 2, pair);
+
+		if (count & 1)
+			p[count - 1] = value;
+
+		row += stride;
+	}
+}
+
+void PixelKernels::clearRect(void* dst, int stride, int x, int y, int w, int h)
+{
+	fill(dst, stride, x, y, w, h, 0);
+}
+
+void PixelKernels::copy(uint32_t* dst, const uint32_t* src, int count)
+{
+	if (count <= 0)
+		return;
+
+	PrvImpl()->copyRow(dst, src, count);
+}
+
+void PixelKernels::blit(void* dst, int dstStride, int dx, int dy,
+						const void* src, int srcStride, int sx, int sy,
+						int w, int h)
+{
+	if (w <= 0 || h <= 0)
+		return;
+
+	const PixelKernelImpl* impl = PrvImpl();
+	uint32_t* dstRow = PrvPixelAt(dst, dstStride, dx, dy);
+	const uint32_t* srcRow = PrvPixelAt(src, srcStride, sx, sy);
+
+	if (w * (int) sizeof(uint32_t) == dstStride && dstStride == srcStride) {
+		impl->copyRow(dstRow, srcRow, w * h);
+		return;
+	}
+
+	for (int i = 0; i < h; i++) {
+		impl->copyRow(dstRow, srcRow, w);
+		dstRow = reinterpret_cast<uint32_t*>(reinterpret_cast<uint8_t*>(dstRow) + dstStride);
+		srcRow = reinterpret_cast<const uint32_t*>(reinterpret_cast<const uint8_t*>(srcRow) + srcStride);
+	}
+}
+
+void PixelKernels::move(void* buffer, int stride, int bytesPerPixel,
+						int x, int y, int w, int h, int dx, int dy)
+{
+	if (w <= 0 || h <= 0 || (dx == 0 && dy == 0))
+		return;
+
+	const PixelKernelImpl* impl = PrvImpl();
+	const int rowBytes = w * bytesPerPixel;
+	uint8_t* base = static_cast<uint8_t*>(buffer);
+
+	// walk rows against the direction of the move so no source row is
+	// overwritten before it is copied
+	int first = 0;
+	int step = 1;
+	if (dy > 0) {
+		first = h - 1;
+		step = -1;
+	}
+
+	for (int i = 0, row = first; i < h; i++, row += step) {
+		uint8_t* src = base + (y + row) * stride + x * bytesPerPixel;
+		uint8_t* dst = base + (y + row + dy) * stride + (x + dx) * bytesPerPixel;
+
+		if (dy == 0 || bytesPerPixel != sizeof(uint32_t)) {
+			// rows overlap with a pure horizontal move
+			::memmove(dst, src, rowBytes);
+		}
+		else {
+			impl->copyRow(reinterpret_cast<uint32_t*>(dst), reinterpret_cast<const uint32_t*>(src), w);
+		}
+	}
+}
+
+// rotation walks the source in square tiles so both the rows read and the
+// rows written stay in cache
+static const int kRotateTile = 32;
+
+// dst(y, x) = src(x, y) for a w x h source. strides may be negative
+static void PrvTranspose(const PixelKernelImpl* impl, int bytesPerPixel,
+						 uint8_t* dst, int dstStride, const uint8_t* src, int srcStride,
+						 int w, int h)
+{
+	const bool is32 = bytesPerPixel == sizeof(uint32_t);
+	const int block = is32 ? kTransposeBlock32 : kTransposeBlock16;
+	const TransposeBlockFunc transposeBlock = is32 ? impl->transposeBlock32 : impl->transposeBlock16;
+
+	for (int ty = 0; ty < h; ty += kRotateTile) {
+		const int th = MIN(kRotateTile, h - ty);
+		const int bh = th - th % block;
+
+		for (int tx = 0; tx < w; tx += kRotateTile) {
+			const int tw = MIN(kRotateTile, w - tx);
+			const int bw = tw - tw % block;
+
+			const uint8_t* s = src + ty * srcStride + tx * bytesPerPixel;
+			uint8_t* d = dst + tx * dstStride + ty * bytesPerPixel;
+
+			for (int y = 0; y < bh; y += block) {
+				for (int x = 0; x < bw; x += block)
+					transposeBlock(d + x * dstStride + y * bytesPerPixel, dstStride,
+								   s + y * srcStride + x * bytesPerPixel, srcStride);
+			}
+
+			// partial blocks only happen along the right and bottom edges
+			if (bw < tw) {
+				if (is32)
+					PrvTransposeC<uint32_t>(d + bw * dstStride, dstStride, s + bw * bytesPerPixel, srcStride, tw - bw, bh);
+				else
+					PrvTransposeC<uint16_t>(d + bw * dstStride, dstStride, s + bw * bytesPerPixel, srcStride, tw - bw, bh);
+			}
+
+			if (bh < th) {
+				if (is32)
+					PrvTransposeC<uint32_t>(d + bh * bytesPerPixel, dstStride, s + bh * srcStride, srcStride, tw, th - bh);
+				else
+					PrvTransposeC<uint16_t>(d + bh * bytesPerPixel, dstStride, s + bh * srcStride, srcStride, tw, th - bh);
+			}
+		}
+	}
+}
+
+bool PixelKernels::rotate(void* dst, int dstStride, int dx, int dy,
+						  const void* src, int srcStride, int sx, int sy,
+						  int w, int h, int bytesPerPixel, int angle)
+{
+	if (bytesPerPixel != sizeof(uint32_t) && bytesPerPixel != sizeof(uint16_t))
+		return false;
+
+	if (w <= 0 || h <= 0)
+		return true;
+
+	const PixelKernelImpl* impl = PrvImpl();
+	uint8_t* d = static_cast<uint8_t*>(dst) + dy * dstStride + dx * bytesPerPixel;
+	const uint8_t* s = static_cast<const uint8_t*>(src) + sy * srcStride + sx * bytesPerPixel;
+
+	switch (angle) {
+	case 0:
+		for (int y = 0; y < h; y++)
+			::memcpy(d + y * dstStride, s + y * srcStride, w * bytesPerPixel);
+		break;
+	case 90:
+		// dst(h - 1 - y, x) = src(x, y): a transpose of the bottom up source
+		PrvTranspose(impl, bytesPerPixel, d, dstStride, s + (h - 1) * srcStride, -srcStride, w, h);
+		break;
+	case 180:
+		for (int y = 0; y < h; y++) {
+			uint8_t* dstRow = d + (h - 1 - y) * dstStride;
+			const uint8_t* srcRow = s + y * srcStride;
+			if (bytesPerPixel == sizeof(uint32_t))
+				impl->reverseRow32(reinterpret_cast<uint32_t*>(dstRow), reinterpret_cast<const uint32_t*>(srcRow), w);
+			else
+				impl->reverseRow16(reinterpret_cast<uint16_t*>(dstRow), reinterpret_cast<const uint16_t*>(srcRow), w);
+		}
+		break;
+	case 270:
+		// dst(y, w - 1 - x) = src(x, y): a transpose into the bottom up destination
+		PrvTranspose(impl, bytesPerPixel, d + (w - 1) * dstStride, -dstStride, s, srcStride, w, h);
+		break;
+	default:
+		return false;
+	}
+
+	return true;
+}
+
+bool PixelKernels::downscale(void* dst, int dstStride, int dx, int dy,
+							 const void* src, int srcStride, int sx, int sy,
+							 int w, int h, int bytesPerPixel, int factor)
+{
+	if (bytesPerPixel != sizeof(uint32_t) && bytesPerPixel != sizeof(uint16_t))
+		return false;
+
+	if (factor != 2 && factor != 4 && factor != 8)
+		return false;
+
+	if (w <= 0 || h <= 0)
+		return true;
+
+	const PixelKernelImpl* impl = PrvImpl();
+	DownscaleRowFunc downscaleRow = bytesPerPixel == sizeof(uint32_t) ? impl->downscaleRow32 : impl->downscaleRow16;
+
+	for (int y = 0; y < h; y++) {
+		const uint8_t* s = static_cast<const uint8_t*>(src) + (sy + y * factor) * srcStride + sx * bytesPerPixel;
+		downscaleRow(PrvPixelAt(dst, dstStride, dx, dy + y), s, srcStride, w, factor);
+	}
+
+	return true;
+}
+
+bool PixelKernels::crossfade(void* dst, int dstStride,
+							 const void* from, int fromStride,
+							 const void* to, int toStride,
+							 int w, int h, int bytesPerPixel, int alpha)
+{
+	if (bytesPerPixel != sizeof(uint32_t) && bytesPerPixel != sizeof(uint16_t))
+		return false;
+
+	if (w <= 0 || h <= 0)
+		return true;
+
+	alpha = CLAMP(alpha, 0, 256);
+
+	const PixelKernelImpl* impl = PrvImpl();
+
+	for (int y = 0; y < h; y++) {
+		uint8_t* d = static_cast<uint8_t*>(dst) + y * dstStride;
+		const uint8_t* f = static_cast<const uint8_t*>(from) + y * fromStride;
+		const uint8_t* t = static_cast<const uint8_t*>(to) + y * toStride;
+
+		if (bytesPerPixel == sizeof(uint32_t))
+			impl->crossfadeRow32(reinterpret_cast<uint32_t*>(d), reinterpret_cast<const uint32_t*>(f),
+								 reinterpret_cast<const uint32_t*>(t), w, alpha);
+		else
+			impl->crossfadeRow16(reinterpret_cast<uint16_t*>(d), reinterpret_cast<const uint16_t*>(f),
+								 reinterpret_cast<const uint16_t*>(t), w, alpha);
+	}
+
+	return true;
+}
+
+static const uint64_t kHashPrime1 = 11400714785074694791ULL;
+static const uint64_t kHashPrime2 = 14029467366897019727ULL;
+static const uint64_t kHashPrime3 = 1609587929392839161ULL;
+static const uint64_t kHashPrime4 = 9650029242287828579ULL;
+static const uint64_t kHashPrime5 = 2870177450012600261ULL;
+
+static inline uint64_t PrvRotl64(uint64_t v, int r)
+{
+	return (v << r) | (v >> (64 - r));
+}
+
+static inline uint64_t PrvRead64(const uint8_t* p)
+{
+	uint64_t v;
+	::memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline uint64_t PrvHashRound(uint64_t acc, uint64_t input)
+{
+	acc += input * kHashPrime2;
+	acc = PrvRotl64(acc, 31);
+	return acc * kHashPrime1;
+}
+
+static inline uint64_t PrvHashMerge(uint64_t acc, uint64_t val)
+{
+	acc ^= PrvHashRound(0, val);
+	return acc * kHashPrime1 + kHashPrime4;
+}
+
+uint64_t PixelKernels::hash(const void* src, int stride, int x, int y, int w, int h,
+							int bytesPerPixel)
+{
+	if (w <= 0 || h <= 0)
+		return 0;
+
+	const int rowBytes = w * bytesPerPixel;
+	uint64_t v1 = kHashPrime1 + kHashPrime2;
+	uint64_t v2 = kHashPrime2;
+	uint64_t v3 = 0;
+	uint64_t v4 = -kHashPrime1;
+	uint64_t tail = kHashPrime5;
+
+	// rows are not contiguous: the four lanes run across all rows in 32 byte
+	// stripes, whatever doesn't fill a stripe goes into a separate tail lane
+	for (int i = 0; i < h; i++) {
+		const uint8_t* p = static_cast<const uint8_t*>(src) + (y + i) * stride + x * bytesPerPixel;
+		const uint8_t* end = p + rowBytes;
+
+		for (; p + 32 <= end; p += 32) {
+			v1 = PrvHashRound(v1, PrvRead64(p));
+			v2 = PrvHashRound(v2, PrvRead64(p + 8));
+			v3 = PrvHashRound(v3, PrvRead64(p + 16));
+			v4 = PrvHashRound(v4, PrvRead64(p + 24));
+		}
+
+		for (; p + 8 <= end; p += 8) {
+			tail ^= PrvHashRound(0, PrvRead64(p));
+			tail = PrvRotl64(tail, 27) * kHashPrime1 + kHashPrime4;
+		}
+
+		for (; p < end; p++) {
+			tail ^= *p * kHashPrime5;
+			tail = PrvRotl64(tail, 11) * kHashPrime1;
+		}
+	}
+
+	uint64_t result = PrvRotl64(v1, 1) + PrvRotl64(v2, 7) + PrvRotl64(v3, 12) + PrvRotl64(v4, 18);
+	result = PrvHashMerge(result, v1);
+	result = PrvHashMerge(result, v2);
+	result = PrvHashMerge(result, v3);
+	result = PrvHashMerge(result, v4);
+	result += (uint64_t) rowBytes * h;
+	result ^= tail;
+
+	result ^= result >> 33;
+	result *= kHashPrime2;
+	result ^= result >> 29;
+	result *= kHashPrime3;
+	result ^= result >> 32;
+
+	return result;
+}
+
+const char* PixelKernels::implementationName()
+{
+	return PrvImpl()->name;
+}
+
+bool PixelKernels::setImplementation(const char* name)
+{
+	for (unsigned int i = 0; i < G_N_ELEMENTS(s_impls); i++) {
+		if (::strcmp(s_impls[i]->name, name) == 0) {
+			if (!PrvCpuSupports(s_impls[i]))
+				return false;
+			s_impl = s_impls[i];
+			return true;
+		}
+	}
+
+	return false;
+}
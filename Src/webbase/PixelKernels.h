@@ -0,0 +1,98 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef PIXELKERNELS_H
+#define PIXELKERNELS_H
+
+#include "Common.h"
+
+#include <stdint.h>
+
+/**
+ * Low level pixel routines used on the software window surfaces.
+ *
+ * Surfaces are 32bpp premultiplied ARGB unless noted. Strides are in bytes. The best
+ * implementation for the running cpu (SSE2, AVX2, NEON or plain C) is picked
+ * the first time any of the routines is used.
+ */
+class PixelKernels
+{
+public:
+
+	// fill a w x h rect at (x, y) with a single 32bpp value
+	static void fill(void* dst, int stride, int x, int y, int w, int h, uint32_t value);
+
+	// fill a w x h rect at (x, y) of a 16bpp (RGB565) surface with a single value
+	static void fill16(void* dst, int stride, int x, int y, int w, int h, uint16_t value);
+
+	// fill a w x h rect at (x, y) with transparent black
+	static void clearRect(void* dst, int stride, int x, int y, int w, int h);
+
+	// copy count premultiplied pixels from src to dst. buffers may not overlap
+	static void copy(uint32_t* dst, const uint32_t* src, int count);
+
+	// copy a w x h rect from (sx, sy) in src to (dx, dy) in dst
+	static void blit(void* dst, int dstStride, int dx, int dy,
+					 const void* src, int srcStride, int sx, int sy,
+					 int w, int h);
+
+	// move a w x h rect at (x, y) by (dx, dy) within one buffer. source and
+	// destination may overlap. works on 16bpp and 32bpp surfaces
+	static void move(void* buffer, int stride, int bytesPerPixel,
+					 int x, int y, int w, int h, int dx, int dy);
+
+	// rotate a w x h rect at (sx, sy) of src clockwise by 90, 180 or 270 degrees
+	// into dst, with the top left corner of the rotated rect at (dx, dy). the
+	// rotated rect is h x w for 90 and 270. works on 16bpp and 32bpp surfaces,
+	// returns false for any other depth or angle
+	static bool rotate(void* dst, int dstStride, int dx, int dy,
+					   const void* src, int srcStride, int sx, int sy,
+					   int w, int h, int bytesPerPixel, int angle);
+
+	// area average a (w * factor) x (h * factor) rect at (sx, sy) of a 32bpp or 16bpp
+	// (RGB565) surface into a w x h 32bpp rect at (dx, dy). factor must be 2, 4 or
+	// 8. returns false for any other depth or factor
+	static bool downscale(void* dst, int dstStride, int dx, int dy,
+						  const void* src, int srcStride, int sx, int sy,
+						  int w, int h, int bytesPerPixel, int factor);
+
+	// blend w x h pixels of from and to into dst, alpha 0 gives from and 256 gives
+	// to. works on 16bpp (RGB565) and 32bpp surfaces, returns false for any other
+	// depth. dst may be from or to
+	static bool crossfade(void* dst, int dstStride,
+						  const void* from, int fromStride,
+						  const void* to, int toStride,
+						  int w, int h, int bytesPerPixel, int alpha);
+
+	// 64 bit hash of the pixels in a w x h rect at (x, y), in the spirit of
+	// xxHash64. for telling whether a region changed, not for security
+	static uint64_t hash(const void* src, int stride, int x, int y, int w, int h,
+						 int bytesPerPixel);
+
+	// name of the implementation in use, for logging and benchmarks
+	static const char* implementationName();
+
+	// forces a given implementation ("c", "sse2", "avx2" or "neon").
+	// returns false if it is not available on this cpu
+	static bool setImplementation(const char* name);
+};
+
+#endif /* PIXELKERNELS_H */
@@ -35,10 +35,12 @@
 #if defined(HAVE_TEXTURESHARING)
 #include "RemoteWindowDataSoftwareTextureShared.h"
 #else
+#include "RemoteWindowDataSoftwareAtlas.h"
 #include "RemoteWindowDataSoftwareQt.h"
 #endif
 
-RemoteWindowData* RemoteWindowDataFactory::generate(int width, int height, bool hasAlpha)
+RemoteWindowData* RemoteWindowDataFactory::generate(int width, int height, bool hasAlpha, bool shareSurface,
+													bool rgb565)
 {
 	RemoteWindowData* data = 0;
 #if defined(HAVE_TEXTURESHARING)
@@ -49,7 +51,15 @@ RemoteWindowData* RemoteWindowDataFactory::generate(int width, int height, bool
 #elif defined(HAVE_OPENGL) && defined(DIRECT_RENDERING)
     data = new RemoteWindowDataOpenGLQt(width, height, hasAlpha);
 #else
-	data = new RemoteWindowDataSoftwareQt(width, height, hasAlpha);
+	if (shareSurface) {
+		data = new RemoteWindowDataSoftwareAtlas(width, height, hasAlpha);
+		if (data->isValid())
+			return data;
+
+		delete data;
+	}
+
+	data = new RemoteWindowDataSoftwareQt(width, height, hasAlpha, true, rgb565);
 #endif	
 	if (!data->isValid()) {
 		delete data;
@@ -76,6 +76,34 @@ public:
 	virtual void resize(int newWidth, int newHeight) = 0;
 	virtual void clear() = 0;
 
+	// Clears rect to transparent black. Must be called between beginPaint and endPaint.
+	// Returns false if the caller has to clear through the rendering context instead.
+	virtual bool clearRect(const QRect& /*rect*/) { return false; }
+
+	// Moves the pixels in rect by (dx, dy) within the buffer. Must be called between
+	// beginPaint and endPaint. Returns false if the caller has to repaint instead.
+	virtual bool scrollRect(const QRect& /*rect*/, int /*dx*/, int /*dy*/) { return false; }
+
+	// Switches an opaque window between 32bpp ARGB and 16bpp RGB565. The format is
+	// advertised to the host through the window metadata. Returns false if not supported.
+	virtual bool setUseRgb565(bool val) { return !val; }
+	virtual bool usesRgb565() const { return false; }
+
+	// true while the pixels live in a buffer shared with other windows, which
+	// keeps them at 32bpp
+	virtual bool sharesSurface() const { return false; }
+
+	// Optional suppression of redundant updates. contentUnchanged() hashes the pixels
+	// in rect and returns true if they are the same as when rect was last sent to the
+	// host, the caller can then drop the update. Call it after endPaint.
+	virtual bool hashesUpdates() const { return false; }
+	virtual bool contentUnchanged(const QRect& /*rect*/) { return false; }
+
+	// Area averages the buffer by factor (2, 4 or 8) into a 32bpp dst of
+	// (width() / factor) x (height() / factor) pixels. Call it outside of
+	// beginPaint/endPaint. Returns false if the pixels aren't in client memory.
+	virtual bool downscaleInto(void* /*dst*/, int /*dstStride*/, int /*factor*/) { return false; }
+
 	void setSupportsDirectRendering(bool val);
 	bool supportsDirectRendering() const;
 
@@ -90,7 +118,10 @@ class RemoteWindowDataFactory
 {
 public:
 
-	static RemoteWindowData* generate(int width, int height, bool hasAlpha);
+	// shareSurface asks for a rect in a buffer shared with other small windows,
+	// rgb565 for a 16bpp buffer where the backend supports it (opaque only)
+	static RemoteWindowData* generate(int width, int height, bool hasAlpha, bool shareSurface = false,
+									  bool rgb565 = false);
 };
 
 #endif /* REMOTEWINDOWDATA_H */
@@ -0,0 +1,201 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "RemoteWindowDataSoftwareAtlas.h"
+
+#include <PIpcBuffer.h>
+#include <QPainter>
+
+#include "WebAppWindowAtlas.h"
+#include "WindowMetaData.h"
+
+RemoteWindowDataSoftwareAtlas::RemoteWindowDataSoftwareAtlas(int width, int height, bool hasAlpha)
+	: RemoteWindowDataSoftwareQt(width, height, hasAlpha, false)
+	, m_atlas(0)
+{
+	if (allocateRect())
+		fillBuffer();
+}
+
+RemoteWindowDataSoftwareAtlas::~RemoteWindowDataSoftwareAtlas()
+{
+	delete m_context;
+	delete m_surface;
+	m_context = 0;
+	m_surface = 0;
+
+	releaseRect();
+}
+
+int RemoteWindowDataSoftwareAtlas::key() const
+{
+	// the page is shared, the metadata buffer is ours alone
+	luna_assert(m_metaDataBuffer);
+	return m_metaDataBuffer->key();
+}
+
+void* RemoteWindowDataSoftwareAtlas::data()
+{
+	luna_assert(m_ipcBuffer);
+	return static_cast<uint8_t*>(m_ipcBuffer->data()) + m_rect.y() * m_pitch + m_rect.x() * sizeof(uint32_t);
+}
+
+int RemoteWindowDataSoftwareAtlas::calcPitch(int width)
+{
+	return m_atlas ? m_atlas->pitch() : RemoteWindowDataSoftwareQt::calcPitch(width);
+}
+
+bool RemoteWindowDataSoftwareAtlas::allocateRect()
+{
+	m_atlas = WebAppWindowAtlas::allocate(m_width, m_height, m_rect);
+	if (!m_atlas)
+		return false;
+
+	m_ipcBuffer = m_atlas->buffer();
+	m_bufferOrigin = m_rect.topLeft();
+	m_pitch = calcPitch(m_width);
+	m_bufferSize = m_pitch * m_height;
+
+	return true;
+}
+
+void RemoteWindowDataSoftwareAtlas::releaseRect()
+{
+	// a private buffer is deleted by RemoteWindowDataSoftwareQt
+	if (!m_atlas)
+		return;
+
+	// the page owns the buffer
+	m_ipcBuffer = 0;
+
+	WebAppWindowAtlas::release(m_atlas, m_rect);
+	m_atlas = 0;
+	m_rect = QRect();
+}
+
+bool RemoteWindowDataSoftwareAtlas::allocatePrivateBuffer()
+{
+	g_warning("RemoteWindowDataSoftwareAtlas: no atlas page for %dx%d, using a private buffer",
+			  m_width, m_height);
+
+	m_rect = QRect(0, 0, m_width, m_height);
+	m_bufferOrigin = QPoint();
+	m_pitch = calcPitch(m_width);
+	m_bufferSize = bufferSize(m_width, m_height);
+	m_ipcBuffer = PIpcBuffer::create(m_bufferSize);
+
+	return m_ipcBuffer != 0;
+}
+
+bool RemoteWindowDataSoftwareAtlas::setUseRgb565(bool val)
+{
+	// atlas pages are 32bpp, a private buffer can switch like any other
+	if (m_atlas)
+		return !val;
+
+	return RemoteWindowDataSoftwareQt::setUseRgb565(val);
+}
+
+void RemoteWindowDataSoftwareAtlas::flip()
+{
+	if (!m_atlas) {
+		RemoteWindowDataSoftwareQt::flip();
+		return;
+	}
+
+	bool hadSurface = m_surface != 0;
+	if (hadSurface) {
+		delete m_context;
+		delete m_surface;
+		m_context = 0;
+		m_surface = 0;
+	}
+
+	// unlike a buffer of its own, the rect doesn't fit the other orientation
+	releaseRect();
+
+	int width = m_width;
+	m_width = m_height;
+	m_height = width;
+
+	if (!allocateRect())
+		allocatePrivateBuffer();
+	luna_assert(m_ipcBuffer);
+
+	fillBuffer();
+	publishSurfaceFormat();
+
+	if (hadSurface) {
+		m_context = new QPainter;
+		createSurface();
+	}
+}
+
+void RemoteWindowDataSoftwareAtlas::resize(int newWidth, int newHeight)
+{
+	if (m_width == newWidth && m_height == newHeight)
+		return;
+
+	if (!m_atlas) {
+		RemoteWindowDataSoftwareQt::resize(newWidth, newHeight);
+		return;
+	}
+
+	if (m_context) {
+		delete m_context;
+		delete m_surface;
+		m_context = 0;
+		m_surface = 0;
+	}
+
+	releaseRect();
+	m_displayOpened = false;
+
+	m_width = newWidth;
+	m_height = newHeight;
+
+	if (!allocateRect())
+		allocatePrivateBuffer();
+	luna_assert(m_ipcBuffer);
+
+	fillBuffer();
+	publishSurfaceFormat();
+
+	m_context = new QPainter;
+	createSurface();
+}
+
+void RemoteWindowDataSoftwareAtlas::publishSurfaceFormat()
+{
+	RemoteWindowDataSoftwareQt::publishSurfaceFormat();
+
+	if (!m_metaDataBuffer || !m_ipcBuffer)
+		return;
+
+	m_metaDataBuffer->lock();
+	WindowMetaData* metaData = (WindowMetaData*) m_metaDataBuffer->data();
+	metaData->atlasKey = m_ipcBuffer->key();
+	metaData->atlasX = m_rect.x();
+	metaData->atlasY = m_rect.y();
+	m_metaDataBuffer->unlock();
+}
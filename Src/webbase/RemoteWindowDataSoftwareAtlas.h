@@ -0,0 +1,68 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef REMOTEWINDOWDATASOFTWAREATLAS_H
+#define REMOTEWINDOWDATASOFTWAREATLAS_H
+
+#include "Common.h"
+
+#include "RemoteWindowDataSoftwareQt.h"
+
+class WebAppWindowAtlas;
+
+/**
+ * Software window whose pixels live in a rect of a shared WebAppWindowAtlas
+ * page instead of a buffer of its own. The window is identified by its
+ * metadata buffer, which also tells the host where to find the pixels.
+ *
+ * If no page can be had for the window after a flip or resize, it moves to a
+ * private buffer for good. That buffer is published the same way, as an
+ * atlas of its own with the window at 0,0.
+ */
+class RemoteWindowDataSoftwareAtlas : public RemoteWindowDataSoftwareQt
+{
+public:
+
+	RemoteWindowDataSoftwareAtlas(int width, int height, bool hasAlpha);
+	virtual ~RemoteWindowDataSoftwareAtlas();
+
+	virtual bool isValid() const { return m_ipcBuffer != 0; }
+	virtual int key() const;
+	virtual void flip();
+	virtual void resize(int newWidth, int newHeight);
+	virtual bool setUseRgb565(bool val);
+	virtual bool sharesSurface() const { return m_atlas != 0; }
+
+protected:
+
+	virtual void* data();
+	virtual int	 calcPitch(int width);
+	virtual void publishSurfaceFormat();
+
+	bool allocateRect();
+	void releaseRect();
+	bool allocatePrivateBuffer();
+
+	WebAppWindowAtlas* m_atlas;
+	QRect m_rect;
+};
+
+#endif /* REMOTEWINDOWDATASOFTWAREATLAS_H */
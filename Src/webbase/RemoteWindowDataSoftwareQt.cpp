@@ -21,6 +21,7 @@
 #include "WebAppManager.h"
 
 #include <stdint.h>
+#include <stdlib.h>
 #include <sys/ioctl.h>
 #include <linux/fb.h>
 #include <sys/types.h>
@@ -34,31 +35,33 @@
 #define MESSAGES_INTERNAL_FILE "SysMgrMessagesInternal.h"
 #include <PIpcMessageMacros.h>
 
+#include "PixelKernels.h"
 #include "WindowMetaData.h"
 #include "Logging.h"
 #include "Settings.h"
 
-RemoteWindowDataSoftwareQt::RemoteWindowDataSoftwareQt(int width, int height, bool hasAlpha, bool createIpcBuffer)
+RemoteWindowDataSoftwareQt::RemoteWindowDataSoftwareQt(int width, int height, bool hasAlpha, bool createIpcBuffer,
+													   bool rgb565)
 	: m_ipcBuffer(0)
 	, m_width(width)
 	, m_height(height)
 	, m_pitch(0)
 	, m_hasAlpha(hasAlpha)
+	, m_rgb565(rgb565 && !hasAlpha)
+	, m_bufferSize(0)
 	, m_context(0)
 	, m_surface(0)
 	, m_directRendering(false)
 	, m_displayOpened(false)
+	, m_hashUpdates(::getenv("LUNA_HASH_WINDOW_UPDATES") != 0)
+	, m_pendingHash(0)
 {
 	m_pitch = calcPitch(m_width);
     
 	if (createIpcBuffer) {
-		const int size = m_pitch * m_height;
-		m_ipcBuffer = PIpcBuffer::create(size);
-
-		if (m_hasAlpha)
-			memset(m_ipcBuffer->data(), 0x00, size);
-		else
-			memset(m_ipcBuffer->data(), 0xFF, size);
+		m_bufferSize = bufferSize(m_width, m_height);
+		m_ipcBuffer = PIpcBuffer::create(m_bufferSize);
+		fillBuffer();
 	}
 }
 
@@ -72,6 +75,7 @@ RemoteWindowDataSoftwareQt::~RemoteWindowDataSoftwareQt()
 void RemoteWindowDataSoftwareQt::setWindowMetaDataBuffer(PIpcBuffer* metaDataBuffer)
 {
 	m_metaDataBuffer = metaDataBuffer;
+	publishSurfaceFormat();
 }
 
 int RemoteWindowDataSoftwareQt::key() const
@@ -85,10 +89,11 @@ void RemoteWindowDataSoftwareQt::flip()
 	m_width = m_height;
 	m_height = width;
 	m_pitch = calcPitch(m_width);
+	publishSurfaceFormat();
 
 	if (m_surface) {
         delete m_surface;
-		m_surface = new QImage(reinterpret_cast<uchar*>(data()), m_width, m_height, QImage::Format_ARGB32_Premultiplied);
+		createSurface();
 		if (!m_directRendering) {
             if (m_context)
                 delete m_context;
@@ -103,7 +108,7 @@ QPainter* RemoteWindowDataSoftwareQt::qtRenderingContext()
 		return m_context;
 	}
 
-	m_surface = new QImage(reinterpret_cast<uchar*>(data()), m_width, m_height, QImage::Format_ARGB32_Premultiplied);
+	createSurface();
 	m_context = new QPainter;
 
 	return m_context;
@@ -133,9 +138,87 @@ void RemoteWindowDataSoftwareQt::endPaint(bool preserveOnFlip, const QRect& rect
 void RemoteWindowDataSoftwareQt::sendWindowUpdate(int x, int y, int w, int h)
 {
 	luna_assert(m_channel);
-	if (!m_directRendering) {
-		m_channel->sendAsyncMessage(new ViewHost_UpdateWindowRegion(key(), x, y, w, h));
+	if (m_directRendering)
+		return;
+
+	if (m_hashUpdates)
+		recordUpdateHash(QRect(x, y, w, h));
+
+	x += m_bufferOrigin.x();
+	y += m_bufferOrigin.y();
+
+	// the damage goes through the metadata ring. only wake the host if it
+	// isn't already busy draining it
+	if (m_metaDataBuffer) {
+		WindowMetaData* metaData = (WindowMetaData*) m_metaDataBuffer->data();
+		if (!metaData->publishDamage(x, y, w, h))
+			return;
+	}
+
+	m_channel->sendAsyncMessage(new ViewHost_UpdateWindowRegion(key(), x, y, w, h));
+}
+
+bool RemoteWindowDataSoftwareQt::contentUnchanged(const QRect& rect)
+{
+	if (!m_hashUpdates)
+		return false;
+
+	QRect r = rect.intersected(QRect(0, 0, m_width, m_height));
+	if (r.isEmpty())
+		return false;
+
+	uint64_t hash = PixelKernels::hash(data(), m_pitch, r.x(), r.y(), r.width(), r.height(),
+									   m_rgb565 ? sizeof(uint16_t) : sizeof(uint32_t));
+
+	for (unsigned int i = 0; i < m_updateHashes.size(); i++) {
+		if (m_updateHashes[i].rect == rect && m_updateHashes[i].hash == hash)
+			return true;
 	}
+
+	// remembered once the update is actually sent
+	m_pendingHashRect = rect;
+	m_pendingHash = hash;
+	return false;
+}
+
+bool RemoteWindowDataSoftwareQt::downscaleInto(void* dst, int dstStride, int factor)
+{
+	if (m_directRendering || !m_ipcBuffer)
+		return false;
+
+	lock();
+	bool ok = PixelKernels::downscale(dst, dstStride, 0, 0, data(), m_pitch, 0, 0,
+									  m_width / factor, m_height / factor,
+									  m_rgb565 ? sizeof(uint16_t) : sizeof(uint32_t), factor);
+	unlock();
+
+	return ok;
+}
+
+void RemoteWindowDataSoftwareQt::recordUpdateHash(const QRect& rect)
+{
+	static const unsigned int kMaxUpdateHashes = 16;
+
+	// whatever the host saw in an overlapping region is stale now
+	std::vector<UpdateHash>::iterator it = m_updateHashes.begin();
+	while (it != m_updateHashes.end()) {
+		if (it->rect.intersects(rect))
+			it = m_updateHashes.erase(it);
+		else
+			++it;
+	}
+
+	if (rect == m_pendingHashRect) {
+		if (m_updateHashes.size() >= kMaxUpdateHashes)
+			m_updateHashes.erase(m_updateHashes.begin());
+
+		UpdateHash entry;
+		entry.rect = rect;
+		entry.hash = m_pendingHash;
+		m_updateHashes.push_back(entry);
+	}
+
+	m_pendingHashRect = QRect();
 }
 
 bool RemoteWindowDataSoftwareQt::hasDirectRendering() const
@@ -184,32 +267,136 @@ void RemoteWindowDataSoftwareQt::resize(int newWidth, int newHeight)
 	m_ipcBuffer = 0;
 	m_displayOpened = false;
 
-	const int size = newWidth * newHeight * sizeof(uint32_t);
-	m_ipcBuffer = PIpcBuffer::create(size);
 	m_width = newWidth;
 	m_height = newHeight;
+	m_pitch = calcPitch(m_width);
+	m_bufferSize = bufferSize(m_width, m_height);
+	m_ipcBuffer = PIpcBuffer::create(m_bufferSize);
 
 	luna_assert(m_ipcBuffer);
 
-	if (m_hasAlpha)
-		memset(m_ipcBuffer->data(), 0x00, size);
-	else
-		memset(m_ipcBuffer->data(), 0xFF, size);
+	fillBuffer();
+	publishSurfaceFormat();
 
 	m_context = new QPainter;
-	m_surface = new QImage(reinterpret_cast<uchar*>(data()), m_width, m_height, QImage::Format_ARGB32_Premultiplied);
+	createSurface();
 }
 
 int RemoteWindowDataSoftwareQt::calcPitch(int width) {
+	if (m_rgb565) {
+		// keep scanlines 32 bit aligned like QImage does
+		return (sizeof(uint16_t) * width + 3) & ~3;
+	}
 	return sizeof(uint32_t) * width;
 }
 
+int RemoteWindowDataSoftwareQt::bufferSize(int width, int height)
+{
+	// big enough for either orientation, flip() reuses the buffer
+	return qMax(calcPitch(width) * height, calcPitch(height) * width);
+}
+
+void RemoteWindowDataSoftwareQt::createSurface()
+{
+	// the buffer layout changed under the remembered hashes
+	m_updateHashes.clear();
+
+	m_surface = new QImage(reinterpret_cast<uchar*>(data()), m_width, m_height, m_pitch,
+						   m_rgb565 ? QImage::Format_RGB16 : QImage::Format_ARGB32_Premultiplied);
+}
+
+void RemoteWindowDataSoftwareQt::fillBuffer()
+{
+	// a freshly created buffer starts transparent, or white for opaque windows
+	if (m_rgb565)
+		PixelKernels::fill16(data(), m_pitch, 0, 0, m_width, m_height, 0xFFFF);
+	else
+		PixelKernels::fill(data(), m_pitch, 0, 0, m_width, m_height,
+						   m_hasAlpha ? 0x00000000 : 0xFFFFFFFF);
+}
+
+void RemoteWindowDataSoftwareQt::publishSurfaceFormat()
+{
+	if (!m_metaDataBuffer)
+		return;
+
+	m_metaDataBuffer->lock();
+	WindowMetaData* metaData = (WindowMetaData*) m_metaDataBuffer->data();
+	metaData->surfaceFormat = m_rgb565 ? WindowMetaData::SurfaceFormatRGB565 : WindowMetaData::SurfaceFormatARGB32;
+	metaData->surfacePitch = m_pitch;
+	m_metaDataBuffer->unlock();
+}
+
+bool RemoteWindowDataSoftwareQt::setUseRgb565(bool val)
+{
+	// windows with alpha need the 32bpp buffer
+	if (val && m_hasAlpha)
+		return false;
+
+	if (val == m_rgb565)
+		return true;
+
+	luna_assert(m_ipcBuffer);
+
+	// the buffer key is the window's routing id, so switch formats in place. A
+	// 16bpp layout always fits; going back to 32bpp needs the original buffer size.
+	// The buffer shrinks to the new format on the next resize.
+	bool oldRgb565 = m_rgb565;
+	m_rgb565 = val;
+	if (bufferSize(m_width, m_height) > m_bufferSize) {
+		m_rgb565 = oldRgb565;
+		return false;
+	}
+
+	delete m_context;
+	delete m_surface;
+	m_context = 0;
+	m_surface = 0;
+
+	lock();
+	m_pitch = calcPitch(m_width);
+	fillBuffer();
+	unlock();
+
+	publishSurfaceFormat();
+
+	return true;
+}
+
 void RemoteWindowDataSoftwareQt::clear() {
 	lock();
-	memset(data(), 0, m_pitch * m_height);
+	if (m_rgb565)
+		PixelKernels::fill16(data(), m_pitch, 0, 0, m_width, m_height, 0x0000);
+	else
+		PixelKernels::clearRect(data(), m_pitch, 0, 0, m_width, m_height);
 	unlock();
 	bool oldDirectRendering = m_directRendering;
 	m_directRendering = false;
 	sendWindowUpdate(0, 0, m_width, m_height);
 	m_directRendering = oldDirectRendering;
 }
+
+bool RemoteWindowDataSoftwareQt::clearRect(const QRect& rect)
+{
+	// only touch the damaged rows, the caller already holds the buffer lock
+	QRect r = rect.intersected(QRect(0, 0, m_width, m_height));
+	if (r.isEmpty())
+		return true;
+
+	if (m_rgb565)
+		PixelKernels::fill16(data(), m_pitch, r.x(), r.y(), r.width(), r.height(), 0x0000);
+	else
+		PixelKernels::clearRect(data(), m_pitch, r.x(), r.y(), r.width(), r.height());
+	return true;
+}
+
+bool RemoteWindowDataSoftwareQt::scrollRect(const QRect& rect, int dx, int dy)
+{
+	QRect bounds(0, 0, m_width, m_height);
+	if (!bounds.contains(rect) || !bounds.contains(rect.translated(dx, dy)))
+		return false;
+
+	PixelKernels::move(data(), m_pitch, m_rgb565 ? sizeof(uint16_t) : sizeof(uint32_t),
+					   rect.x(), rect.y(), rect.width(), rect.height(), dx, dy);
+	return true;
+}
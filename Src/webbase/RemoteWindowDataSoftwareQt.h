@@ -22,6 +22,9 @@
 #include "RemoteWindowData.h"
 #include "Logging.h"
 
+#include <vector>
+#include <QRect>
+
 class QPainter;
 class QImage;
 class PIpcBuffer;
@@ -30,7 +33,9 @@ class RemoteWindowDataSoftwareQt : public RemoteWindowData
 {
 public:
 
-	RemoteWindowDataSoftwareQt(int width, int height, bool hasAlpha, bool createIpcBuffer=true);
+	// rgb565 picks the 16bpp layout up front for opaque windows
+	RemoteWindowDataSoftwareQt(int width, int height, bool hasAlpha, bool createIpcBuffer=true,
+							   bool rgb565=false);
 	virtual ~RemoteWindowDataSoftwareQt();
 
 	virtual int key() const;
@@ -53,6 +58,13 @@ public:
 
 	virtual void resize(int newWidth, int newHeight);
 	virtual void clear();
+	virtual bool clearRect(const QRect& rect);
+	virtual bool scrollRect(const QRect& rect, int dx, int dy);
+	virtual bool setUseRgb565(bool val);
+	virtual bool usesRgb565() const { return m_rgb565; }
+	virtual bool hashesUpdates() const { return m_hashUpdates; }
+	virtual bool contentUnchanged(const QRect& rect);
+	virtual bool downscaleInto(void* dst, int dstStride, int factor);
     virtual bool supportsPartialUpdates() const { return false; }
 protected:
 
@@ -60,18 +72,41 @@ protected:
 	virtual void unlock();
 	virtual void* data();
 	virtual int	 calcPitch(int width);
+	int bufferSize(int width, int height);
+	void fillBuffer();
+	void createSurface();
+	virtual void publishSurfaceFormat();
+	void recordUpdateHash(const QRect& rect);
 	
 	PIpcBuffer* m_ipcBuffer;
 	int m_width;
 	int m_height;
 	int m_pitch;
 	bool m_hasAlpha;
+	bool m_rgb565;
+	int m_bufferSize;
 
     QPainter* m_context;
     QImage* m_surface;
 	bool m_directRendering;
 	bool m_displayOpened;
 
+	// where the window starts in the buffer the host maps. Damage is sent in
+	// buffer coordinates
+	QPoint m_bufferOrigin;
+
+	// hashes of the regions the host was last told about. An entry is only
+	// valid as long as no other update overlapped it
+	struct UpdateHash {
+		QRect rect;
+		uint64_t hash;
+	};
+
+	bool m_hashUpdates;
+	std::vector<UpdateHash> m_updateHashes;
+	QRect m_pendingHashRect;
+	uint64_t m_pendingHash;
+
 	friend class WindowedWebApp;
 
 private:
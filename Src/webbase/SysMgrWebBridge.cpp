@@ -5,6 +5,8 @@
 #include "Utils.h"
 #include "WebAppBase.h"
 #include "WebAppManager.h"
+#include "WebPageEvents.h"
+#include "WebPageThrottle.h"
 
 #include <QDebug>
 
@@ -13,6 +15,8 @@
 
 
 SysMgrWebBridge::SysMgrWebBridge(bool viewable) : m_page(0),
+                                                  m_throttle(0),
+                                                  m_events(0),
                                                   m_client(0),
                                                   m_progress(0),
                                                   m_viewable(viewable),
@@ -25,6 +29,8 @@ SysMgrWebBridge::SysMgrWebBridge(bool viewable) : m_page(0),
 }
 
 SysMgrWebBridge::SysMgrWebBridge(bool viewable, QUrl url) : m_page(0),
+                                                            m_throttle(0),
+                                                            m_events(0),
                                                             m_client(0),
                                                             m_progress(0),
                                                             m_viewable(viewable),
@@ -42,6 +48,8 @@ void SysMgrWebBridge::commonSetup()
 {
     // TODO: PalmIME field types
     m_page = new SysMgrWebPage(this);
+    m_throttle = new WebPageThrottle(m_page);
+    m_events = new WebPageEvents(m_page);
     QWebFrame* frame = m_page->mainFrame();
 
     if (m_viewable) {
@@ -52,6 +60,7 @@ void SysMgrWebBridge::commonSetup()
     connect(frame, SIGNAL(contentsSizeChanged(const QSize&)), this, SIGNAL(signalResizedContents(const QSize&)));
     connect(m_page, SIGNAL(geometryChangeRequested(const QRect&)), this, SIGNAL(signalGeometryChanged(const QRect&)));
     connect(m_page, SIGNAL(repaintRequested(const QRect&)), this, SIGNAL(signalInvalidateRect(const QRect&)));
+    connect(m_page, SIGNAL(scrollRequested(int, int, const QRect&)), this, SIGNAL(signalScrollRequested(int, int, const QRect&)));
     connect(m_page, SIGNAL(linkClicked(const QUrl&)), this, SIGNAL(signalLinkClicked(const QUrl&)));
     connect(frame, SIGNAL(titleChanged(const QString&)), this, SIGNAL(signalTitleChanged(const QString&)));
 //    connect(frame, SIGNAL(urlChanged(const QUrl&)), this, SIGNAL(signalUrlChanged(const QUrl&)));
@@ -87,6 +96,10 @@ void SysMgrWebBridge::commonSetup()
 SysMgrWebBridge::~SysMgrWebBridge() 
 {
     m_isShuttingDown = true;
+    delete m_events;
+    m_events = 0;
+    delete m_throttle;
+    m_throttle = 0;
     delete m_page;
     m_page = 0;
 }
@@ -148,9 +161,9 @@ bool SysMgrWebBridge::relaunch(const char* args, const char* launchingAppId, con
         m_jsObj->setLaunchParams(m_args);
 
     m_inRelaunch = true;
-    QVariant ret = m_page->mainFrame()->evaluateJavaScript(QString("Mojo.relaunch()"));
+    bool ret = m_events->relaunch();
     m_inRelaunch = false;
-    return ret.isValid() && ret.toBool();
+    return ret;
 }
 
 void SysMgrWebBridge::slotMicroFocusChanged()
@@ -381,6 +394,12 @@ void SysMgrWebBridge::slotLoadFinished(bool ok)
 void SysMgrWebBridge::slotJavaScriptWindowObjectCleared()
 {
     addPalmSystemObject();
+    m_throttle->windowObjectCleared();
+
+    // the slots are only for app pages installed on the device, remote
+    // content has no business faking their replies
+    if (m_page->mainFrame()->url().isLocalFile())
+        m_events->windowObjectCleared();
 }
 
 void SysMgrWebBridge::slotViewportChangeRequested()
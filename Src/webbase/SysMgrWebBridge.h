@@ -14,6 +14,8 @@
 typedef QMap<QString, QVariant> StringVariantMap;
 class WebAppBase;
 class PalmSystem;
+class WebPageEvents;
+class WebPageThrottle;
 
 class SysMgrWebPage : public QWebPage {
     Q_OBJECT
@@ -63,6 +65,8 @@ class SysMgrWebBridge : public QObject,
         virtual ~SysMgrWebBridge();
 
         SysMgrWebPage* page() const { return m_page; }
+        WebPageThrottle* throttle() const { return m_throttle; }
+        WebPageEvents* events() const { return m_events; }
         int progress() const { return m_progress; }
         QUrl url() const { return m_page->mainFrame()->url(); }
         bool relaunch(const char* args, const char* launchingAppId, const char* launchingProcId);
@@ -119,6 +123,7 @@ class SysMgrWebBridge : public QObject,
         void signalResizedContents(const QSize&);
         void signalGeometryChanged(const QRect&);
         void signalInvalidateRect(const QRect&);
+        void signalScrollRequested(int dx, int dy, const QRect&);
         void signalLinkClicked(const QUrl&);
         void signalTitleChanged(const QString&);
         void signalUrlChanged(const QUrl&);
@@ -135,6 +140,8 @@ class SysMgrWebBridge : public QObject,
 
     private:
         SysMgrWebPage* m_page;
+        WebPageThrottle* m_throttle;
+        WebPageEvents* m_events;
         WebAppBase* m_client;
         int m_progress;
         bool m_viewable;
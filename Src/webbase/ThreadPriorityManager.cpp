@@ -0,0 +1,339 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "ThreadPriorityManager.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <cjson/json.h>
+
+#include "Time.h"
+
+static const int kDefaultNiceOffsets[ThreadPriorityManager::NumPhases] = {
+	5,		// Background
+	0,		// Normal
+	-2,		// Animation
+	-4,		// Launch
+	-4		// Input
+};
+
+static const char* const kPhaseNames[ThreadPriorityManager::NumPhases] = {
+	"background", "normal", "animation", "launch", "input"
+};
+
+static const int kMinNice = -20;
+static const int kMaxNice = 19;
+
+static int PrvClampNice(int nice)
+{
+	return nice < kMinNice ? kMinNice : (nice > kMaxNice ? kMaxNice : nice);
+}
+
+// lowest nice level this process may set, see setpriority(2)
+static int PrvLowestAllowedNice()
+{
+	if (geteuid() == 0)
+		return kMinNice;
+
+	struct rlimit limit;
+	if (getrlimit(RLIMIT_NICE, &limit) != 0)
+		return kMaxNice + 1;
+
+	if (limit.rlim_cur == RLIM_INFINITY)
+		return kMinNice;
+
+	// above kMaxNice when the process may not lower its nice level at all
+	return 20 - (int) limit.rlim_cur;
+}
+
+ThreadPriorityManager* ThreadPriorityManager::instance()
+{
+	static ThreadPriorityManager* s_instance = 0;
+	if (G_UNLIKELY(s_instance == 0))
+		s_instance = new ThreadPriorityManager;
+
+	return s_instance;
+}
+
+const char* ThreadPriorityManager::phaseName(Phase phase)
+{
+	return (phase >= 0 && phase < NumPhases) ? kPhaseNames[phase] : "unknown";
+}
+
+ThreadPriorityManager::ThreadPriorityManager()
+	: m_tid((pid_t) syscall(SYS_gettid))
+	, m_baseNice(0)
+	, m_minNice(0)
+	, m_canLower(true)
+	, m_appliedNice(0)
+	, m_phase(Normal)
+	, m_failedChanges(0)
+	, m_holdSource(0)
+	, m_holdDueMs(0)
+{
+	// -1 is a valid nice level, errno tells it apart from a failure
+	errno = 0;
+	int nice = getpriority(PRIO_PROCESS, m_tid);
+	if (nice != -1 || errno == 0)
+		m_baseNice = nice;
+
+	m_appliedNice = m_baseNice;
+	m_minNice = PrvLowestAllowedNice();
+
+	// once lowered we could never get back up, so don't go there at all
+	m_canLower = (m_minNice <= m_baseNice);
+
+	for (int i = 0; i < NumPhases; i++) {
+		m_niceOffset[i] = kDefaultNiceOffsets[i];
+		m_entered[i] = 0;
+		m_holdUntilMs[i] = 0;
+		m_phaseMs[i] = 0;
+		m_phaseEntries[i] = 0;
+	}
+
+	m_phaseEntries[Normal] = 1;
+	m_phaseStartMs = Time::curTimeMs();
+
+	loadPolicy();
+
+	if (!m_canLower)
+		g_message("ThreadPriorityManager: no permission to change priority, staying at nice %d",
+				  m_baseNice);
+	else if (m_minNice >= m_baseNice)
+		g_message("ThreadPriorityManager: no permission to raise priority above nice %d, "
+				  "interactive phases run at the normal level", m_baseNice);
+}
+
+void ThreadPriorityManager::loadPolicy()
+{
+	const char* policy = ::getenv("LUNA_THREAD_PRIORITIES");
+	if (!policy)
+		return;
+
+	char* copy = strdup(policy);
+	char* state = 0;
+	for (char* entry = strtok_r(copy, ",", &state); entry; entry = strtok_r(0, ",", &state)) {
+
+		char* value = strchr(entry, '=');
+		if (!value) {
+			g_warning("ThreadPriorityManager: ignoring policy entry '%s'", entry);
+			continue;
+		}
+		*value++ = 0;
+
+		int phase = 0;
+		while (phase < NumPhases && strcmp(entry, kPhaseNames[phase]) != 0)
+			phase++;
+
+		char* end = 0;
+		long offset = strtol(value, &end, 10);
+		if (phase == NumPhases || end == value || *end) {
+			g_warning("ThreadPriorityManager: ignoring policy entry '%s=%s'", entry, value);
+			continue;
+		}
+
+		m_niceOffset[phase] = (int) offset;
+	}
+
+	free(copy);
+}
+
+void ThreadPriorityManager::hold(Phase phase, uint32_t durationMs)
+{
+	uint32_t until = Time::curTimeMs() + durationMs;
+	if (!m_holdUntilMs[phase] || (int32_t) (until - m_holdUntilMs[phase]) > 0)
+		m_holdUntilMs[phase] = until;
+
+	// longer holds of the running phase are picked up when the source fires,
+	// which keeps this cheap enough to call for every input event
+	if (phase != m_phase || !m_holdSource)
+		update();
+}
+
+void ThreadPriorityManager::enter(Phase phase)
+{
+	m_entered[phase]++;
+	update();
+}
+
+void ThreadPriorityManager::leave(Phase phase)
+{
+	if (m_entered[phase] > 0)
+		m_entered[phase]--;
+	update();
+}
+
+gboolean ThreadPriorityManager::holdExpired(gpointer arg)
+{
+	ThreadPriorityManager* manager = static_cast<ThreadPriorityManager*>(arg);
+
+	// update() attaches a new source if another hold is still running
+	g_source_unref(manager->m_holdSource);
+	manager->m_holdSource = 0;
+	manager->update();
+
+	return FALSE;
+}
+
+void ThreadPriorityManager::update()
+{
+	uint32_t now = Time::curTimeMs();
+	int32_t nextExpiryMs = 0;
+
+	bool held[NumPhases];
+	for (int i = 0; i < NumPhases; i++) {
+		held[i] = m_entered[i] > 0;
+
+		if (m_holdUntilMs[i]) {
+			int32_t left = (int32_t) (m_holdUntilMs[i] - now);
+			if (left > 0) {
+				held[i] = true;
+				if (!nextExpiryMs || left < nextExpiryMs)
+					nextExpiryMs = left;
+			}
+			else {
+				m_holdUntilMs[i] = 0;
+			}
+		}
+	}
+
+	Phase phase = Normal;
+	for (int i = NumPhases - 1; i > Normal; i--) {
+		if (held[i]) {
+			phase = (Phase) i;
+			break;
+		}
+	}
+
+	if (phase == Normal && held[Background])
+		phase = Background;
+
+	uint32_t due = nextExpiryMs ? now + nextExpiryMs : 0;
+	if (m_holdSource && (!due || due != m_holdDueMs)) {
+		g_source_destroy(m_holdSource);
+		g_source_unref(m_holdSource);
+		m_holdSource = 0;
+	}
+
+	if (due && !m_holdSource) {
+		m_holdSource = g_timeout_source_new(nextExpiryMs);
+		g_source_set_priority(m_holdSource, G_PRIORITY_HIGH);
+		g_source_set_callback(m_holdSource, ThreadPriorityManager::holdExpired, this, NULL);
+		g_source_attach(m_holdSource, g_main_context_default());
+		m_holdDueMs = due;
+	}
+
+	if (phase == m_phase)
+		return;
+
+	m_phaseMs[m_phase] += now - m_phaseStartMs;
+	m_phaseStartMs = now;
+	m_phase = phase;
+	m_phaseEntries[phase]++;
+
+	apply(m_baseNice + m_niceOffset[phase]);
+}
+
+void ThreadPriorityManager::registerThread()
+{
+	pid_t tid = (pid_t) syscall(SYS_gettid);
+	if (tid == m_tid)
+		return;
+
+	errno = 0;
+	int nice = getpriority(PRIO_PROCESS, tid);
+	if ((nice == -1 && errno != 0) || nice == m_baseNice)
+		return;
+
+	if (setpriority(PRIO_PROCESS, tid, m_baseNice) != 0)
+		g_warning("ThreadPriorityManager: can't reset thread %d from nice %d to %d",
+				  (int) tid, nice, m_baseNice);
+}
+
+void ThreadPriorityManager::apply(int nice)
+{
+	nice = PrvClampNice(nice);
+	if (nice < m_minNice)
+		nice = MIN(m_minNice, m_baseNice);
+	if (nice > m_baseNice && !m_canLower)
+		nice = m_baseNice;
+
+	if (nice == m_appliedNice)
+		return;
+
+	if (setpriority(PRIO_PROCESS, m_tid, nice) == 0) {
+		m_appliedNice = nice;
+		return;
+	}
+
+	int err = errno;
+	m_failedChanges++;
+
+	if ((err == EPERM || err == EACCES) && nice < m_appliedNice) {
+		// we may have lost CAP_SYS_NICE or the limit was lowered, stop asking
+		m_minNice = m_appliedNice;
+		if (m_appliedNice > m_baseNice) {
+			g_warning("ThreadPriorityManager: can't get back to nice %d, staying at %d",
+					  m_baseNice, m_appliedNice);
+			m_baseNice = m_appliedNice;
+			m_canLower = false;
+		}
+		else {
+			g_message("ThreadPriorityManager: no permission to go below nice %d", m_minNice);
+		}
+		return;
+	}
+
+	g_warning("ThreadPriorityManager: setpriority(%d) failed: %s", nice, strerror(err));
+}
+
+void ThreadPriorityManager::toJson(json_object* obj) const
+{
+	uint32_t now = Time::curTimeMs();
+
+	json_object* phases = json_object_new_array();
+	for (int i = 0; i < NumPhases; i++) {
+		uint64_t ms = m_phaseMs[i];
+		if (i == m_phase)
+			ms += now - m_phaseStartMs;
+
+		json_object* p = json_object_new_object();
+		json_object_object_add(p, (char*) "phase", json_object_new_string(kPhaseNames[i]));
+		json_object_object_add(p, (char*) "niceOffset", json_object_new_int(m_niceOffset[i]));
+		json_object_object_add(p, (char*) "entries", json_object_new_int(m_phaseEntries[i]));
+		json_object_object_add(p, (char*) "ms", json_object_new_double((double) ms));
+		json_object_array_add(phases, p);
+	}
+
+	json_object_object_add(obj, (char*) "phase", json_object_new_string(kPhaseNames[m_phase]));
+	json_object_object_add(obj, (char*) "baseNice", json_object_new_int(m_baseNice));
+	json_object_object_add(obj, (char*) "nice", json_object_new_int(m_appliedNice));
+	json_object_object_add(obj, (char*) "canRaise", json_object_new_boolean(m_minNice < m_baseNice));
+	json_object_object_add(obj, (char*) "canLower", json_object_new_boolean(m_canLower));
+	json_object_object_add(obj, (char*) "failedChanges", json_object_new_int(m_failedChanges));
+	json_object_object_add(obj, (char*) "phases", phases);
+}
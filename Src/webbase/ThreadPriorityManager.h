@@ -0,0 +1,131 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef THREADPRIORITYMANAGER_H
+#define THREADPRIORITYMANAGER_H
+
+#include "Common.h"
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <glib.h>
+
+struct json_object;
+
+/**
+ * Adjusts the nice level of the main thread to what it is busy with.
+ *
+ * Interactive phases (input, foreground launches, animations) raise the
+ * priority, background work (boot time headless apps, deferred refreshes, gc)
+ * lowers it. Phases are either held for a while after the last trigger, or
+ * entered and left around a piece of work. The most interactive phase that is
+ * held wins, background only applies when nothing interactive is going on.
+ *
+ * The nice offset of each phase comes from LUNA_THREAD_PRIORITIES, e.g.
+ * "input=-4,launch=-4,animation=-2,background=5". Without the privilege to
+ * raise the priority the interactive phases stay at the startup level, and
+ * background is only applied if the thread can come back from it.
+ *
+ * Threads created by the main thread inherit the level of the phase it is in
+ * at the time. Threads started here call registerThread() to go back to the
+ * startup level. Threads WebKit and Qt start on their own can't be reached
+ * and keep the level they inherited.
+ */
+class ThreadPriorityManager
+{
+public:
+
+	enum Phase {
+		Background = 0,
+		Normal,
+		Animation,
+		Launch,
+		Input,
+		NumPhases
+	};
+
+	// must first be called from the main thread, it is the one being adjusted
+	static ThreadPriorityManager* instance();
+
+	// stay in phase for at least the next durationMs
+	void hold(Phase phase, uint32_t durationMs);
+
+	// stay in phase until the matching leave(), calls nest
+	void enter(Phase phase);
+	void leave(Phase phase);
+
+	// enter()s phase for its lifetime
+	class Scope
+	{
+	public:
+		Scope(Phase phase) : m_phase(phase) { ThreadPriorityManager::instance()->enter(phase); }
+		~Scope() { ThreadPriorityManager::instance()->leave(m_phase); }
+	private:
+		Phase m_phase;
+	};
+
+	Phase phase() const { return m_phase; }
+
+	// call first thing on a new thread: drops the nice level it inherited
+	// from the main thread's current phase
+	void registerThread();
+
+	// adds the policy, time spent in each phase and failures to obj
+	void toJson(json_object* obj) const;
+
+	static const char* phaseName(Phase phase);
+
+private:
+
+	ThreadPriorityManager();
+
+	void loadPolicy();
+	void update();
+	void apply(int nice);
+
+	static gboolean holdExpired(gpointer arg);
+
+	pid_t m_tid;
+	int m_baseNice;
+	int m_minNice;
+	bool m_canLower;
+	int m_appliedNice;
+
+	int m_niceOffset[NumPhases];
+	int m_entered[NumPhases];
+	uint32_t m_holdUntilMs[NumPhases];
+
+	Phase m_phase;
+	uint32_t m_phaseStartMs;
+	uint64_t m_phaseMs[NumPhases];
+	uint32_t m_phaseEntries[NumPhases];
+	uint32_t m_failedChanges;
+
+	GSource* m_holdSource;
+	uint32_t m_holdDueMs;
+
+private:
+
+	ThreadPriorityManager(const ThreadPriorityManager&);
+	ThreadPriorityManager& operator=(const ThreadPriorityManager&);
+};
+
+#endif /* THREADPRIORITYMANAGER_H */
@@ -25,6 +25,7 @@
 #include <algorithm>
 
 #include "WebAppBase.h"
+#include "WindowedWebApp.h"
 
 typedef std::list<WebAppBase*> WebAppCacheType;
 static WebAppCacheType* s_cache = 0;
@@ -75,3 +76,17 @@ void WebAppCache::flush()
 	}
 
 }
+
+int WebAppCache::compact()
+{
+	WebAppCacheType* cache = PrvCache();
+	int bytes = 0;
+
+	// the frame a cached card shows on thaw stays in its window buffer
+	for (WebAppCacheType::const_iterator it = cache->begin(); it != cache->end(); ++it) {
+		if ((*it)->isWindowed())
+			bytes += static_cast<WindowedWebApp*>(*it)->releaseMemory();
+	}
+
+	return bytes;
+}
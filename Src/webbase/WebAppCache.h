@@ -33,6 +33,9 @@ public:
 	static void put(WebAppBase* app);
 	static void remove(WebAppBase* app);
 	static void flush();
+
+	// releases what the cached apps only keep for painting, returns the bytes freed
+	static int compact();
 };
 
 #endif /* WEBAPPCACHE_H */
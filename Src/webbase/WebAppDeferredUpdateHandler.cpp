@@ -22,23 +22,47 @@
 #include "Common.h"
 
 #include <set>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <functional>
 #include <glib.h>
 
 #include "WebAppDeferredUpdateHandler.h"
+#include "CpuLoadSampler.h"
 #include "SysMgrWebBridge.h"
+#include "ThreadPriorityManager.h"
+#include "WebAppPaintStats.h"
 #include "WindowedWebApp.h"
 
 typedef std::set<WindowedWebApp*> AppSet;
+typedef std::map<WindowedWebApp*, uint32_t> FocusSerialMap;
+typedef std::vector<std::pair<int, WindowedWebApp*> > RankedApps;
 
 static AppSet s_registeredApps = AppSet();
 static AppSet s_nonActiveApps = AppSet();
+static FocusSerialMap s_focusSerials = FocusSerialMap();
+static uint32_t s_lastFocusSerial = 0;
 static WindowedWebApp* s_activeApp = 0;
 static GSource* s_paintSource = 0;
-static const int kPaintTimeOutSecs = 1;
-static const int kActiveAppThrottle = 100;
-static const int kInactiveAppThrottle = 5;
-static const int kActiveAppMinTimerIntervalMs = 0;
-static const int kInactiveAppMinTimerIntervalMs = 2000;
+
+// the idle source fires every kRefreshSlotMs and paints deferred apps for up to
+// kRefreshBudgetMs of it, but always at least one
+static const int kRefreshSlotMs = 100;
+static const int kRefreshBudgetMs = 12;
+
+// above this system load (per mille) the budget is cut to kBusyRefreshBudgetMs,
+// the deferred apps then catch up more slowly instead of competing for the cpu
+static const unsigned kBusySystemLoad = 800;
+static const int kBusyRefreshBudgetMs = 4;
+
+// refresh priority weights, see refreshPriority()
+static const int kVisibleWeight = 1000;
+static const int kRecentFocusWeight = 400;
+static const int kCardWeight = 100;
+static const int kStalenessStepMs = 100;
+static const int kMaxStalenessWeight = 300;
+
 
 void WebAppDeferredUpdateHandler::registerApp(WindowedWebApp* app)
 {
@@ -64,6 +88,7 @@ void WebAppDeferredUpdateHandler::unregisterApp(WindowedWebApp* app)
 
     s_registeredApps.erase(app);
 	s_nonActiveApps.erase(app);
+	s_focusSerials.erase(app);
 }
 
 void WebAppDeferredUpdateHandler::directRenderingActive(WindowedWebApp* app)
@@ -107,13 +132,46 @@ void WebAppDeferredUpdateHandler::directRenderingInactive(WindowedWebApp* app)
 	if (s_nonActiveApps.empty())
 		return;
 
+	// what the host shows is brought up to date right away. Occluded apps stay
+	// suspended until the idle source gets to them, so their backlog of damage
+	// isn't all rendered at once
+	AppSet visibleApps;
 	for (AppSet::const_iterator it = s_nonActiveApps.begin();
 		 it != s_nonActiveApps.end(); ++it) {
+		if (!(*it)->hostOccluded())
+			visibleApps.insert(*it);
+	}
+
+	for (AppSet::const_iterator it = visibleApps.begin(); it != visibleApps.end(); ++it) {
+		// a paint may have unregistered or reactivated one of the others
+		if (s_nonActiveApps.erase(*it) == 0)
+			continue;
+
 		//printf("%s: resuming %p\n", __PRETTY_FUNCTION__, *it);
 		(*it)->resumeAppRendering();
+		(*it)->paint();
 	}
 
-	startIdleUpdateTimer();
+	if (!s_nonActiveApps.empty())
+		startIdleUpdateTimer();
+}
+
+void WebAppDeferredUpdateHandler::appFocused(WindowedWebApp* app)
+{
+	if (s_registeredApps.find(app) == s_registeredApps.end())
+		return;
+
+	s_focusSerials[app] = ++s_lastFocusSerial;
+
+	// the user switched to it, it can't wait for its turn
+	if (s_nonActiveApps.erase(app) == 0)
+		return;
+
+	app->resumeAppRendering();
+	app->paint();
+
+	if (s_nonActiveApps.empty())
+		stopIdleUpdateTimer();
 }
 
 void WebAppDeferredUpdateHandler::startIdleUpdateTimer()
@@ -123,7 +181,8 @@ void WebAppDeferredUpdateHandler::startIdleUpdateTimer()
 
 	//printf("%s", __PRETTY_FUNCTION__);
 
-	s_paintSource = g_timeout_source_new_seconds(kPaintTimeOutSecs);
+	s_paintSource = g_timeout_source_new(kRefreshSlotMs);
+	g_source_set_priority(s_paintSource, G_PRIORITY_DEFAULT_IDLE);
 	g_source_set_callback(s_paintSource, WebAppDeferredUpdateHandler::paintSourceCallback,
 						  NULL, NULL);
 	g_source_attach(s_paintSource, g_main_context_default());
@@ -144,36 +203,91 @@ gboolean WebAppDeferredUpdateHandler::paintSourceCallback(gpointer)
 {
 	//printf("%s", __PRETTY_FUNCTION__);
 
+	const uint64_t startUs = WebAppPaintStats::currentTimeUs();
+
+	// nobody is looking at these, input and the app in front go first
+	ThreadPriorityManager::Scope background(ThreadPriorityManager::Background);
+
+	// apps that weren't damaged while suspended have nothing to catch up on
+	RankedApps ranked;
+	for (AppSet::iterator it = s_nonActiveApps.begin(); it != s_nonActiveApps.end();) {
+		WindowedWebApp* app = *it;
+		if (!app->paintStats().pendingDamageSinceUs()) {
+			app->resumeAppRendering();
+			s_nonActiveApps.erase(it++);
+			continue;
+		}
+
+		ranked.push_back(std::make_pair(refreshPriority(app, startUs), app));
+		++it;
+	}
+
+	std::sort(ranked.begin(), ranked.end(), std::greater<RankedApps::value_type>());
+
+	int budgetMs = kRefreshBudgetMs;
+	if (CpuLoadSampler::instance()->systemLoad() >= kBusySystemLoad)
+		budgetMs = kBusyRefreshBudgetMs;
+
+	int refreshed = 0;
+	for (RankedApps::const_iterator it = ranked.begin(); it != ranked.end(); ++it) {
+		if (refreshed && WebAppPaintStats::currentTimeUs() - startUs >= (uint64_t) budgetMs * 1000)
+			break;
+
+		// a paint may have unregistered or reactivated one of the others
+		WindowedWebApp* app = it->second;
+		if (s_nonActiveApps.erase(app) == 0)
+			continue;
+
+		// only occluded apps wait here, a plain paint would be held back
+		app->resumeAppRendering();
+		app->paintInBackground();
+		refreshed++;
+	}
+
+	if (refreshed)
+		g_debug("%s: refreshed %d of %d deferred apps in %d us", __PRETTY_FUNCTION__,
+				refreshed, (int) ranked.size(), (int) (WebAppPaintStats::currentTimeUs() - startUs));
+
 	if (s_nonActiveApps.empty()) {
 		stopIdleUpdateTimer();
 		return false;
 	}
 
-	AppSet::iterator it = s_nonActiveApps.begin();
-	WindowedWebApp* app = *it;
-	s_nonActiveApps.erase(it);
+	return true;
+}
 
-    app->paint();
+int WebAppDeferredUpdateHandler::refreshPriority(WindowedWebApp* app, uint64_t now)
+{
+	int priority = 0;
 
-	return true;
+	// an occluded app only records its damage when painted, so it's cheap but
+	// also unlikely to be looked at soon
+	if (!app->hostOccluded())
+		priority += kVisibleWeight;
+
+	// the host stacks cards by focus, so the last focused ones are on top and
+	// the most likely to be switched to next
+	FocusSerialMap::const_iterator it = s_focusSerials.find(app);
+	if (it != s_focusSerials.end())
+		priority += kRecentFocusWeight / (1 + s_lastFocusSerial - it->second);
+
+	if (app->windowType() == WindowType::Type_Card)
+		priority += kCardWeight;
+
+	uint64_t damagedUs = app->paintStats().pendingDamageSinceUs();
+	if (damagedUs && now > damagedUs)
+		priority += MIN((int) ((now - damagedUs) / 1000 / kStalenessStepMs), kMaxStalenessWeight);
+
+	return priority;
 }
 
 void WebAppDeferredUpdateHandler::suspendApp(WindowedWebApp* app)
 {
+	// the timers of unfocused cards are already throttled by WebPageThrottle
 	app->suspendAppRendering();
-/*
-	WebPage* page = app->page();
-	if (page && page->webkitPage())
-		page->webkitPage()->throttle(kInactiveAppThrottle, kInactiveAppMinTimerIntervalMs);
-*/
 }
 
 void WebAppDeferredUpdateHandler::resumeApp(WindowedWebApp* app)
 {
 	s_activeApp->resumeAppRendering();
-/*
-	WebPage* page = app->page();
-	if (page && page->webkitPage())
-		page->webkitPage()->throttle(kActiveAppThrottle, kActiveAppMinTimerIntervalMs);
-*/
 }
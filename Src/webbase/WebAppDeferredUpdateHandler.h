@@ -22,8 +22,20 @@
 #ifndef WEBAPPDEFERREDUPDATEHANDLER_H
 #define WEBAPPDEFERREDUPDATEHANDLER_H
 
+#include <stdint.h>
+
 class WindowedWebApp;
 
+/**
+ * Keeps the other cards from rendering while one app renders directly, and
+ * brings them up to date in the background once it stops.
+ *
+ * Deferred apps are refreshed from an idle source, most important first: ones
+ * the host shows, then by how recently they had focus (the card the user most
+ * likely switches to next, and the top of the card stack), cards before other
+ * windows, and older damage before newer. Each slot refreshes as many apps as
+ * its time budget allows.
+ */
 class WebAppDeferredUpdateHandler
 {
 public:
@@ -34,11 +46,15 @@ public:
 	static void directRenderingActive(WindowedWebApp* app);
 	static void directRenderingInactive(WindowedWebApp* app);
 
+	// app got focus, recently focused apps are refreshed first
+	static void appFocused(WindowedWebApp* app);
+
 private:
 
 	static void startIdleUpdateTimer();
 	static void stopIdleUpdateTimer();
 	static gboolean paintSourceCallback(gpointer);
+	static int refreshPriority(WindowedWebApp* app, uint64_t now);
 	static void suspendApp(WindowedWebApp* app);
 	static void resumeApp(WindowedWebApp* app);
 };
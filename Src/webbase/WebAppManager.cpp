@@ -34,6 +34,9 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <malloc.h>
+#include <stdio.h>
+#include <unistd.h>
 
 
 #include <PIpcChannel.h>
@@ -44,6 +47,7 @@
 #include "SystemUiController.h"
 #include "ApplicationDescription.h"
 #include "CardWebApp.h"
+#include "CpuLoadSampler.h"
 #include "ProcessManager.h"
 #include "Localization.h"
 #include "LocalePreferences.h"
@@ -54,7 +58,10 @@
 #include "BannerMessageEventFactory.h"
 #include "Settings.h"
 #include "WebAppBase.h"
+#include "WebAppCache.h"
 #include "WebAppFactory.h"
+#include "WebAppTileCache.h"
+#include "WebPageThrottle.h"
 #include "WindowedWebApp.h"
 //#include "Preferences.h"
 #include "EventReporter.h"
@@ -63,6 +70,7 @@
 #include "Utils.h"
 #include "Time.h"
 #include "SharedGlobalProperties.h"
+#include "ThreadPriorityManager.h"
 
 #include <ProcessKiller.h>
 
@@ -71,6 +79,7 @@
 #include "lunaservice.h"
 
 #include <QDebug>
+#include <QWebSettings>
 
 #ifdef HAS_NYX
 #include <nyx/nyx_client.h>
@@ -105,6 +114,10 @@ static bool s_universalSearchReady = false;
 
 static BootState s_bootState = BootStateUninitialized;
 static const uint32_t s_bootTimeout = 60;
+// the rest of the system should be below this load (per mille) before we call
+// boot finished, unless it stays busy for longer than kBootQuietWaitSecs
+static const unsigned kBootBusySystemLoad = 500;
+static const int kBootQuietWaitSecs = 20;
 static PIpcChannel *s_ipcChannel = 0;
 static PIpcBuffer* s_globalPropsBuffer = 0;
 
@@ -117,6 +130,12 @@ static const int kGcPowerdActivityDuration = 10000;
 static const int kGcStartTimeout = 2000;
 static const unsigned kGcCpuIdleThreshold = 800; // percentage times 1000
 static const unsigned kNumTimesIgnoreGc = 5;
+// how long the display off gc pass may keep the device busy, well within
+// kGcPowerdActivityDuration
+static const uint32_t kGcReclaimBudgetMs = 3000;
+
+// a foreground launch runs at launch priority until about its first paint
+static const uint32_t kLaunchPriorityMs = 2000;
 
 class InputEvent : public Event
 {
@@ -154,6 +173,8 @@ static WebAppManager* sInstance = 0;
 static const int kLunaStatsReportingIntervalSecs = 5;
 
 static bool PrvGetMemoryStatus(LSHandle* handle, LSMessage* message, void* ctxt);
+static bool PrvGetPaintStats(LSHandle* handle, LSMessage* message, void* ctxt);
+static bool PrvGetSchedulingStats(LSHandle* handle, LSMessage* message, void* ctxt);
 static bool PrvGetSystemTimeCallback(LSHandle* handle, LSMessage* message, void* ctxt);
 
 #ifdef USE_HEAP_PROFILER
@@ -174,6 +195,8 @@ static bool PrvEnableAccelCompositing(WindowType::Type winType, const std::strin
 
 static LSMethod sStatsMethodsPublic[] = {
 	{ "getMemoryStatus", PrvGetMemoryStatus },
+	{ "getPaintStats", PrvGetPaintStats },
+	{ "getSchedulingStats", PrvGetSchedulingStats },
 	{ NULL,       NULL},
 };
 
@@ -250,6 +273,11 @@ void WebAppManager::run()
 	// needs to be initialized once per process
 	EventReporter::init(mainLoop());
 
+	CpuLoadSampler::instance()->start();
+
+	// adjusts the thread it is created on
+	ThreadPriorityManager::instance();
+
 	markUniversalSearchReady();
 
     LocalePreferences* lp = LocalePreferences::instance();
@@ -364,58 +392,6 @@ void WebAppManager::onDisconnected()
 	           __PRETTY_FUNCTION__, __LINE__);
 	exit(-1);
 }
-/* $$$ ## $$$ - Temporarily disabled code to coaelesce events
-void WebAppManager::onInputEvent(int ipcKey, const SysMgrEventWrapper& wrapper)
-{
-	Event *evt = new Event;
-	memcpy(&(evt->type), &(wrapper.event->type), sizeof(SysMgrEvent));
-
-	sptr<Event> e = evt;
-
-	// Coaelesce input events
-	if (e->type == Event::GestureChange) {
-
-
-		std::list<sptr<Event> >::reverse_iterator rfirst(m_eventsList.end());
-		std::list<sptr<Event> >::reverse_iterator rlast(m_eventsList.begin());
-
-		bool coalesced = false;
-		while (rfirst != rlast) {
-			sptr<Event> evt = *rfirst;
-			if (evt->type == Event::GestureStart) {
-				// cannot coalesce
-				break;
-			}
-			else if (e->type == Event::GestureChange) {
-				evt->time = e->time;
-				evt->x = e->x;
-				evt->y = e->y;
-				evt->gestureCenterX = e->gestureCenterX;
-				evt->gestureCenterY = e->gestureCenterY;
-				evt->gestureScale = e->gestureScale;
-				evt->gestureRotate = e->gestureRotate;
-				coalesced = true;
-				break;
-			}
-
-			rfirst++;
-		}
-
-		if (coalesced) {
-			return;
-		}
-	}
-
-	WindowedWebApp *winApp = appForIpcKey(ipcKey);
-	if (!winApp) {
-		g_critical("%s (%d). Failed to find app with key: %d\n",
-			 __PRETTY_FUNCTION__, __LINE__, ipcKey);
-		return;
-	} else {
-		winApp->inputEvent(e);
-	}
-}
-*/
 
 const std::string WebAppManager::getTimeZone()
 {
@@ -949,6 +925,9 @@ WebAppBase* WebAppManager::launchUrlInternal(const std::string& url, WindowType:
 			g_source_attach(s_bootupIdleSrc, g_main_loop_get_context(mainLoop()));
 			s_ipcChannel = m_channel;
 			s_bootState = BootStateWaitingForIdle;
+
+			// headless boot apps load in the background, up to bootFinished()
+			ThreadPriorityManager::instance()->enter(ThreadPriorityManager::Background);
 		}
 	}
 
@@ -994,6 +973,10 @@ WebAppBase* WebAppManager::launchUrlInternal(const std::string& url, WindowType:
 	if (!procId.size())
 		procId = ProcessManager::instance()->processIdFactory();
 
+	if (winType == WindowType::Type_Card || winType == WindowType::Type_ChildCard ||
+		winType == WindowType::Type_ModalChildWindowCard)
+		ThreadPriorityManager::instance()->hold(ThreadPriorityManager::Launch, kLaunchPriorityMs);
+
 	WebAppBase* app = WebAppFactory::instance()->createWebApp(winType, m_channel, desc);
 
     if (winType == WindowType::Type_None)
@@ -1242,6 +1225,9 @@ void WebAppManager::bootFinished()
 
 	g_warning("@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@ BOOT SEQUENCE COMPLETE");
 
+	if (s_bootState != BootStateUninitialized)
+		ThreadPriorityManager::instance()->leave(ThreadPriorityManager::Background);
+
 	s_bootState = BootStateFinished;
 	s_universalSearchReady = true;
 
@@ -1288,7 +1274,16 @@ gboolean WebAppManager::BootupIdleCallback(gpointer)
 	const int minCount = 3;
 	const int maxJitterInMs = 5;
 
-	if (((now.tv_sec - tv.tv_sec) * 1000000 + (now.tv_usec - tv.tv_usec)) / 1000 < maxJitterInMs) {
+	static time_t s_firstCheck = now.tv_sec;
+
+	// we keep a cpu busy ourselves while spinning here, only the others count
+	CpuLoadSampler* sampler = CpuLoadSampler::instance();
+	unsigned othersLoad = sampler->systemLoad() - MIN(sampler->processLoad(), sampler->systemLoad());
+	bool systemBusy = sampler->hasSample() && othersLoad >= kBootBusySystemLoad &&
+					  now.tv_sec - s_firstCheck < kBootQuietWaitSecs;
+
+	if (!systemBusy &&
+		((now.tv_sec - tv.tv_sec) * 1000000 + (now.tv_usec - tv.tv_usec)) / 1000 < maxJitterInMs) {
 
 		tv = now;
 		count++;
@@ -1512,6 +1507,8 @@ bool WebAppManager::preventAppUnderLowMemory(const std::string& appId, WindowTyp
 
 void WebAppManager::slotMemoryStateChanged(MemoryWatcher::MemState state)
 {
+	WebAppTileCache::memoryStateChanged(state);
+
 	const char* normalStateStr = "normal";
 	const char* lowStateStr = "low";
 	const char* criticalStateStr = "critical";
@@ -1579,6 +1576,36 @@ LSHandle* WebAppManager::getStatsServiceHandle() const
 	return m_servicePrivate;
 }
 
+json_object* WebAppManager::paintStatsJson(const std::string& appId) const
+{
+	json_object* windows = json_object_new_array();
+
+	for (AppWindowMap::const_iterator it = m_appWinMap.begin();
+	     it != m_appWinMap.end(); ++it) {
+
+		WindowedWebApp* app = it->second;
+		if (!app)
+			continue;
+
+		std::string id = app->appId().toStdString();
+		if (!appId.empty() && id != appId)
+			continue;
+
+		json_object* window = json_object_new_object();
+		json_object_object_add(window, (char*) "appId", json_object_new_string(id.c_str()));
+		json_object_object_add(window, (char*) "processId",
+							   json_object_new_string(app->processId().toStdString().c_str()));
+		json_object_object_add(window, (char*) "windowType", json_object_new_int(app->windowType()));
+		app->paintStats().toJson(window);
+		if (app->page() && app->page()->throttle())
+			app->page()->throttle()->toJson(window);
+
+		json_object_array_add(windows, window);
+	}
+
+	return windows;
+}
+
 #ifdef USE_HEAP_PROFILER
 //->Start of API documentation comment block
 /**
@@ -2189,13 +2216,31 @@ bool WebAppManager::displayManagerCallback(LSHandle* sh, LSMessage* message, voi
 		WebAppManager* wam = WebAppManager::instance();
 		if (!wam->m_displayOn)  {
 			wam->m_displayOn = true;			
+			WindowedWebApp* foreground = 0;
+			for (AppList::const_iterator it = wam->m_appList.begin();
+				 it != wam->m_appList.end(); ++it) {
+				WebAppBase* app = (WebAppBase*) *it;
+				if (app->isWindowed()) {
+					WindowedWebApp* win = static_cast<WindowedWebApp*>(app);
+					win->displayOn();
+					win->updateThrottleState();
+					if (win->isFocused())
+						foreground = win;
+				}
+			}
+
+			// one paint per window for all it got while the display was off:
+			// the card in front right away, the others from their paint timers
+			if (foreground)
+				foreground->repaintAfterDisplayOn(true);
 			for (AppList::const_iterator it = wam->m_appList.begin();
 				 it != wam->m_appList.end(); ++it) {
 				WebAppBase* app = (WebAppBase*) *it;
-				if (app->isWindowed())
-					static_cast<WindowedWebApp*>(app)->displayOn();
+				if (app->isWindowed() && app != foreground)
+					static_cast<WindowedWebApp*>(app)->repaintAfterDisplayOn(false);
 			}
 		
+			CpuLoadSampler::instance()->setPaused(false);
 			wam->stopGcPowerdActivity();
 //			Palm::WebGlobal::notifyWake();
 		}
@@ -2207,8 +2252,10 @@ bool WebAppManager::displayManagerCallback(LSHandle* sh, LSMessage* message, voi
 			for (AppList::const_iterator it = wam->m_appList.begin();
 				 it != wam->m_appList.end(); ++it) {
 				WebAppBase* app = (WebAppBase*) *it;
-				if (app->isWindowed())
+				if (app->isWindowed()) {
 					static_cast<WindowedWebApp*>(app)->displayOff();
+					static_cast<WindowedWebApp*>(app)->updateThrottleState();
+				}
 			}
 
 			wam->startGcPowerdActivity();
@@ -2250,6 +2297,10 @@ void WebAppManager::startGcPowerdActivity()
 				  __PRETTY_FUNCTION__, lsError.message);
 		LSErrorFree(&lsError);
 		m_gcPowerdActivityId = std::string();
+
+		// no gc pass will need the cpu load
+		if (!m_displayOn)
+			CpuLoadSampler::instance()->setPaused(true);
 		return;
 	}
 		
@@ -2377,104 +2428,123 @@ Done:
 	return true;
 }
 
-static long
-percentages(int cnt, int *out, long *now, long *old, long *diffs)
+//->Start of API documentation comment block
+/**
+@page com_palm_lunastats com.palm.lunastats
+@{
+@section com_palm_lunastats_getPaintStats getPaintStats
+
+Return paint performance counters for each window, along with the throttle
+state of its page, how often the page's timers woke it up and how fast input
+reached it. Render times and update latencies (first damage to the update sent
+to the window server) are histograms with bucket upper bounds of 1, 2, 4, 8,
+16, 33 and 66 ms; the last bucket holds everything slower.
+
+@par Parameters
+Name | Required | Type | Description
+-----|--------|------|----------
+appId | no | string | Only report windows of this app
+
+@par Returns(Call)
+Name | Required | Type | Description
+-----|--------|------|----------
+windows     | yes | array  | Per window objects: appId, processId, windowType, paints, pixels, damageRects, suppressedPaints (held back while the host hides the window), hashedUpdates, unchangedUpdates and unchangedUpdateRate (updates dropped because their pixels didn't change, with LUNA_HASH_WINDOW_UPDATES set), paintsPerSec, recentPaintsPerSec, renderTime and updateLatency (each with histogram, avgMs and maxMs), inputEvents (input events delivered to the page), coalescedInputEvents (pen moves and gesture changes merged into a later one), inputEventAllocations (events allocated to deliver input, stays at 1 once the window got input unless input arrives from a nested main loop), inputLatency (receipt of the oldest merged event until the page handled it, with histogram, avgMs and maxMs), throttleState (active, background or frozen), throttleStateChanges, timerWakeups (timer and animation frame callbacks run in each throttle state) and heldBackWakeups (timer runs a freeze held back or skipped)
+returnValue | yes | bool   | Always true
+
+@par Returns(Subscription)
+None
+@}
+*/
+//->End of API documentation comment block
+
+bool PrvGetPaintStats(LSHandle* handle, LSMessage* message, void* ctxt)
 {
-	register int i;
-	register long change;
-	register long total_change;
-	register long *dp;
-	long half_total;
+    // {"appId": string}
+    VALIDATE_SCHEMA_AND_RETURN(handle,
+                               message,
+                               SCHEMA_1(OPTIONAL(appId, string)));
 
-	/* initialization */
-	total_change = 0;
-	dp = diffs;
+	LSError lsError;
+	LSErrorInit(&lsError);
 
-	/* calculate changes for each state and the overall change */
-	for (i = 0; i < cnt; i++)
-	{
-		if ((change = *now - *old) < 0)
-		{
-			/* this only happens when the counter wraps */
-			change = (int)
-				((unsigned long)*now-(unsigned long)*old);
-		}
-		total_change += (*dp++ = change);
-		*old++ = *now++;
-	}
+	std::string appId;
 
-	/* avoid divide by zero potential */
-	if (total_change == 0)
-	{
-		total_change = 1;
+	json_object* json = json_tokener_parse(LSMessageGetPayload(message));
+	if (json && !is_error(json)) {
+		json_object* label = json_object_object_get(json, "appId");
+		if (label && !is_error(label))
+			appId = json_object_get_string(label);
+		json_object_put(json);
 	}
 
-	/* calculate percentages based on overall change, rounding up */
-	half_total = total_change / 2l;
-	for (i = 0; i < cnt; i++)
-	{
-		*out++ = (int)((*diffs++ * 1000 + half_total) / total_change);
-	}
+	json_object* reply = json_object_new_object();
+	json_object_object_add(reply, "returnValue", json_object_new_boolean(true));
+	json_object_object_add(reply, "windows", WebAppManager::instance()->paintStatsJson(appId));
 
-	/* return the total in case the caller wants to use it */
-	return(total_change);
-}
+	if (!LSMessageReply(handle, message, json_object_to_json_string(reply), &lsError))
+		LSErrorFree(&lsError);
 
-static inline char *
-skip_token(const char *p)
-{
-	while (isspace(*p)) p++;
-	while (*p && !isspace(*p)) p++;
-	return (char *)p;
+	json_object_put(reply);
+
+	return true;
 }
 
-static void
-read_stat(int *cpu_states, long *cp_time, long *cp_old, long *cp_diff, bool sample_only)
-{
-	char buffer[4096+1];
-	int fd, len;
-	char *p;
+//->Start of API documentation comment block
+/**
+@page com_palm_lunastats com.palm.lunastats
+@{
+@section com_palm_lunastats_getSchedulingStats getSchedulingStats
 
-	if ((fd = open("/proc/stat", O_RDONLY)) != -1)
-	{
-		if ((len = read(fd, buffer, sizeof(buffer)-1)) > 0)
-		{
-			buffer[len] = '\0';
-			p = skip_token(buffer);                     /* "cpu" */
-			cp_time[0] = strtoul(p, &p, 0);
-			cp_time[1] = strtoul(p, &p, 0);
-			cp_time[2] = strtoul(p, &p, 0);
-			cp_time[3] = strtoul(p, &p, 0);
+Return how the priority of the main thread followed what it was busy with.
+Input, foreground launches and animations raise it, boot time headless apps,
+deferred card refreshes and gc lower it. The nice offset of each phase can be
+set with LUNA_THREAD_PRIORITIES, e.g. "input=-4,launch=-4,animation=-2,background=5".
 
-			/* convert cp_time counts to percentages */
+@par Parameters
+None
 
-			if (!sample_only)
-				percentages(4, cpu_states, cp_time, cp_old, cp_diff);
-		}
-		close(fd);
-	}
-}
+@par Returns(Call)
+Name | Required | Type | Description
+-----|--------|------|----------
+phase         | yes | string | Current phase: background, normal, animation, launch or input
+baseNice      | yes | int    | Nice level of the normal phase
+nice          | yes | int    | Nice level in use
+canRaise      | yes | bool   | False if the process may not go below baseNice, interactive phases then run at baseNice
+canLower      | yes | bool   | False if the process couldn't come back from a higher nice level, background then runs at baseNice
+failedChanges | yes | int    | Priority changes refused by the kernel
+phases        | yes | array  | Per phase objects: phase, niceOffset, entries (times the phase was entered) and ms (time spent in it)
+returnValue   | yes | bool   | Always true
+
+@par Returns(Subscription)
+None
+@}
+*/
+//->End of API documentation comment block
 
-static unsigned
-CpuIdle(void)
+bool PrvGetSchedulingStats(LSHandle* handle, LSMessage* message, void* ctxt)
 {
-	long cp_time[4];
-	long cp_old[4];
-	long cp_diff[4];
-	int cpu_states[4];
+    EMPTY_SCHEMA_RETURN(handle, message);
 
-	read_stat(NULL, cp_old, NULL, NULL, true);
-	sleep(1);
-	read_stat(cpu_states, cp_time, cp_old, cp_diff, false);
+	LSError lsError;
+	LSErrorInit(&lsError);
 
-	return cpu_states[3];
+	json_object* reply = json_object_new_object();
+	json_object_object_add(reply, "returnValue", json_object_new_boolean(true));
+	ThreadPriorityManager::instance()->toJson(reply);
+
+	if (!LSMessageReply(handle, message, json_object_to_json_string(reply), &lsError))
+		LSErrorFree(&lsError);
+
+	json_object_put(reply);
+
+	return true;
 }
 
 bool WebAppManager::gcPowerdActivtyTimerCallback()
 {
 
 	static unsigned s_cancelledGCs = 0;
-	if (s_cancelledGCs < kNumTimesIgnoreGc && CpuIdle() < kGcCpuIdleThreshold) {
+	if (s_cancelledGCs < kNumTimesIgnoreGc && CpuLoadSampler::instance()->systemIdle() < kGcCpuIdleThreshold) {
 		s_cancelledGCs++;
 		g_message("%s: Skipping gc because CPU too busy", __PRETTY_FUNCTION__);
 	}
@@ -2483,19 +2553,105 @@ bool WebAppManager::gcPowerdActivtyTimerCallback()
 
 		g_message("%s: Calling gc....", __PRETTY_FUNCTION__);
 
+		ThreadPriorityManager::Scope background(ThreadPriorityManager::Background);
+
 		uint32_t startTime = Time::curTimeMs();
-		int gcIterationCount = 1;
-/*		while (!Palm::WebGlobal::notifySleep())
-			gcIterationCount++;*/
+		reclaimMemory(kGcReclaimBudgetMs);
 		uint32_t endTime = Time::curTimeMs();
 
-		g_message("%s: Gc took %d iterations and %d ms", __PRETTY_FUNCTION__, gcIterationCount, endTime - startTime);
+		g_message("%s: Gc took %d ms", __PRETTY_FUNCTION__, endTime - startTime);
 	}
 
 	stopGcPowerdActivity();
+
+	// nothing needs the cpu load again until the display comes back on
+	if (!m_displayOn)
+		CpuLoadSampler::instance()->setPaused(true);
 	return false;
 }
 
+static long PrvResidentBytes()
+{
+	FILE* f = fopen("/proc/self/statm", "rb");
+	if (!f)
+		return 0;
+
+	long size = 0;
+	long resident = 0;
+	if (fscanf(f, "%ld %ld", &size, &resident) != 2)
+		resident = 0;
+	fclose(f);
+
+	return resident * sysconf(_SC_PAGESIZE);
+}
+
+void WebAppManager::reclaimMemory(uint32_t budgetMs)
+{
+	enum {
+		StepWebKit = 0,
+		StepWindows,
+		StepAppCache,
+		StepMalloc,
+		NumSteps
+	};
+
+	static const char* const kStepNames[NumSteps] = {
+		"webkit caches", "occluded window caches", "app cache", "malloc trim"
+	};
+
+	uint32_t startTime = Time::curTimeMs();
+	long startRss = PrvResidentBytes();
+
+	for (int step = 0; step < NumSteps; step++) {
+
+		if (Time::curTimeMs() - startTime >= budgetMs) {
+			g_message("%s: out of time, skipping %s and later steps", __PRETTY_FUNCTION__, kStepNames[step]);
+			break;
+		}
+
+		uint32_t stepTime = Time::curTimeMs();
+		long rss = PrvResidentBytes();
+		int released = 0;
+
+		switch (step) {
+		case StepWebKit:
+			// all pages share one js heap, so this collects garbage for every
+			// page, besides emptying the object, page and font caches, dropping
+			// jit code and handing free fastmalloc memory back
+			QWebSettings::clearMemoryCaches();
+			break;
+		case StepWindows:
+			// windows the host covers drop what only speeds up painting, what
+			// it shows keeps it to come back fast on display on. The window
+			// surfaces themselves are shared with the host and stay. Cached
+			// cards are done by the app cache
+			for (AppList::const_iterator it = m_appList.begin(); it != m_appList.end(); ++it) {
+				WebAppBase* app = *it;
+				if (!app->isWindowed() || app->inCache())
+					continue;
+
+				WindowedWebApp* win = static_cast<WindowedWebApp*>(app);
+				if (win->hostOccluded())
+					released += win->releaseMemory();
+			}
+			break;
+		case StepAppCache:
+			released = WebAppCache::compact();
+			break;
+		case StepMalloc:
+			malloc_trim(0);
+			break;
+		}
+
+		g_message("%s: %s: released %d KB, resident size down %ld KB, %d ms", __PRETTY_FUNCTION__,
+				  kStepNames[step], released / 1024, (rss - PrvResidentBytes()) / 1024,
+				  Time::curTimeMs() - stepTime);
+	}
+
+	g_message("%s: resident size %ld KB -> %ld KB", __PRETTY_FUNCTION__,
+			  startRss / 1024, PrvResidentBytes() / 1024);
+}
+
 SharedGlobalProperties* WebAppManager::globalProperties()
 {
     return s_globalPropsBuffer ? (SharedGlobalProperties*) s_globalPropsBuffer->data() : 0;
@@ -57,6 +57,7 @@ class SharedGlobalProperties;
 class SysMgrKeyEvent;
 class SysMgrWebBridge;
 class ApplicationDescription;
+struct json_object;
 
 #define WEB_APP_MGR_IPC_NAME "WebAppManager"
 
@@ -84,6 +85,9 @@ public:
 
 	LSHandle* getStatsServiceHandle() const;
 
+	// paint counters of all windows, or only the ones of appId if it is not empty
+	json_object* paintStatsJson(const std::string& appId) const;
+
 	void copiedToClipboard(const QString& appId);
 	void pastedFromClipboard(const QString& appId);
 
@@ -126,6 +130,7 @@ public:
 	bool inSimulatedMouseEvent() const { return m_inSimulatedMouseEvent; }
 	void setActiveAppId(const std::string& id) { m_activeAppId = id; }
 	const std::string& getActiveAppId() { return m_activeAppId; }
+	bool isDisplayOn() const { return m_displayOn; }
 protected:
 	// IPC control message handlers
 	void onLaunchUrl(const std::string& url, int winType,
@@ -139,7 +144,6 @@ protected:
 	void onRelaunchApp(const std::string& procId, const std::string& args,
 			  		   const std::string& launchingAppId, const std::string& launchingProcId);
 
-	//void onInputEvent(int ipcKey, const SysMgrEventWrapper& wrapper);
 	void onSetOrientation(int orient);
 	void onGlobalProperties(int key);
 	void onInspectByProcessId( const std::string& processId );
@@ -229,6 +233,7 @@ private:
 	void startGcPowerdActivity();
 	void stopGcPowerdActivity();
 	bool gcPowerdActivtyTimerCallback();
+	void reclaimMemory(uint32_t budgetMs);
 	bool isAppRunning(const std::string& appId);
 
     void appDeleted(WebAppBase* app);
@@ -0,0 +1,205 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "WebAppPaintStats.h"
+
+#include <time.h>
+#include <cjson/json.h>
+
+static const uint64_t kRateWindowUs = 5 * 1000 * 1000;
+
+const int WebAppPaintStats::kBucketLimitsMs[WebAppPaintStats::kNumBuckets - 1] = {
+	1, 2, 4, 8, 16, 33, 66
+};
+
+uint64_t WebAppPaintStats::currentTimeUs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+WebAppPaintStats::Histogram::Histogram()
+	: count(0)
+	, totalUs(0)
+	, maxUs(0)
+{
+	for (int i = 0; i < kNumBuckets; i++)
+		buckets[i] = 0;
+}
+
+void WebAppPaintStats::Histogram::add(uint64_t us)
+{
+	int i = 0;
+	while (i < kNumBuckets - 1 && us >= (uint64_t) kBucketLimitsMs[i] * 1000)
+		i++;
+
+	buckets[i]++;
+	count++;
+	totalUs += us;
+	if (us > maxUs)
+		maxUs = us;
+}
+
+void WebAppPaintStats::Histogram::toJson(json_object* obj, const char* name) const
+{
+	json_object* h = json_object_new_object();
+	json_object* b = json_object_new_array();
+	for (int i = 0; i < kNumBuckets; i++)
+		json_object_array_add(b, json_object_new_int(buckets[i]));
+
+	json_object_object_add(h, (char*) "histogram", b);
+	json_object_object_add(h, (char*) "avgMs", json_object_new_double(count ? totalUs / 1000.0 / count : 0.0));
+	json_object_object_add(h, (char*) "maxMs", json_object_new_double(maxUs / 1000.0));
+	json_object_object_add(obj, (char*) name, h);
+}
+
+WebAppPaintStats::WebAppPaintStats()
+	: m_paints(0)
+	, m_pixels(0)
+	, m_damageRects(0)
+	, m_suppressedPaints(0)
+	, m_hashedUpdates(0)
+	, m_unchangedUpdates(0)
+	, m_inputEvents(0)
+	, m_coalescedInputEvents(0)
+	, m_inputEventAllocations(0)
+	, m_paintStartUs(0)
+	, m_paintSegmentStartUs(0)
+	, m_paintActiveUs(0)
+	, m_firstPendingDamageUs(0)
+	, m_rateWindowPaints(0)
+	, m_recentPaintsPerSec(0.0)
+{
+	m_createdUs = currentTimeUs();
+	m_rateWindowStartUs = m_createdUs;
+}
+
+void WebAppPaintStats::damageAdded()
+{
+	m_damageRects++;
+	if (!m_firstPendingDamageUs)
+		m_firstPendingDamageUs = currentTimeUs();
+}
+
+void WebAppPaintStats::paintStarted()
+{
+	m_paintStartUs = currentTimeUs();
+	m_paintSegmentStartUs = m_paintStartUs;
+	m_paintActiveUs = 0;
+}
+
+void WebAppPaintStats::paintSuspended()
+{
+	if (!m_paintStartUs || !m_paintSegmentStartUs)
+		return;
+
+	m_paintActiveUs += currentTimeUs() - m_paintSegmentStartUs;
+	m_paintSegmentStartUs = 0;
+}
+
+void WebAppPaintStats::paintResumed()
+{
+	if (m_paintStartUs && !m_paintSegmentStartUs)
+		m_paintSegmentStartUs = currentTimeUs();
+}
+
+void WebAppPaintStats::paintFinished(int pixels)
+{
+	if (!m_paintStartUs)
+		return;
+
+	uint64_t now = currentTimeUs();
+
+	uint64_t renderUs = m_paintActiveUs;
+	if (m_paintSegmentStartUs)
+		renderUs += now - m_paintSegmentStartUs;
+
+	m_renderTime.add(renderUs);
+	m_paintStartUs = 0;
+	m_paintSegmentStartUs = 0;
+
+	// paints without page damage (resize, flip, ...) have no latency to report
+	if (m_firstPendingDamageUs) {
+		m_updateLatency.add(now - m_firstPendingDamageUs);
+		m_firstPendingDamageUs = 0;
+	}
+
+	m_paints++;
+	m_pixels += pixels;
+
+	m_rateWindowPaints++;
+	if (now - m_rateWindowStartUs >= kRateWindowUs) {
+		m_recentPaintsPerSec = m_rateWindowPaints * 1000000.0 / (now - m_rateWindowStartUs);
+		m_rateWindowStartUs = now;
+		m_rateWindowPaints = 0;
+	}
+}
+
+void WebAppPaintStats::paintSuppressed()
+{
+	m_suppressedPaints++;
+}
+
+void WebAppPaintStats::updateHashed(bool unchanged)
+{
+	m_hashedUpdates++;
+	if (unchanged)
+		m_unchangedUpdates++;
+}
+
+void WebAppPaintStats::inputDelivered(uint64_t latencyUs, int merged)
+{
+	m_inputEvents++;
+	m_coalescedInputEvents += merged;
+	m_inputLatency.add(latencyUs);
+}
+
+void WebAppPaintStats::inputEventAllocated()
+{
+	m_inputEventAllocations++;
+}
+
+void WebAppPaintStats::toJson(json_object* obj) const
+{
+	uint64_t lifetimeUs = currentTimeUs() - m_createdUs;
+
+	json_object_object_add(obj, (char*) "paints", json_object_new_int(m_paints));
+	json_object_object_add(obj, (char*) "pixels", json_object_new_double((double) m_pixels));
+	json_object_object_add(obj, (char*) "damageRects", json_object_new_int(m_damageRects));
+	json_object_object_add(obj, (char*) "suppressedPaints", json_object_new_int(m_suppressedPaints));
+	json_object_object_add(obj, (char*) "hashedUpdates", json_object_new_int(m_hashedUpdates));
+	json_object_object_add(obj, (char*) "unchangedUpdates", json_object_new_int(m_unchangedUpdates));
+	json_object_object_add(obj, (char*) "unchangedUpdateRate",
+						   json_object_new_double(m_hashedUpdates ? (double) m_unchangedUpdates / m_hashedUpdates : 0.0));
+	json_object_object_add(obj, (char*) "paintsPerSec",
+						   json_object_new_double(lifetimeUs ? m_paints * 1000000.0 / lifetimeUs : 0.0));
+	json_object_object_add(obj, (char*) "recentPaintsPerSec", json_object_new_double(m_recentPaintsPerSec));
+	json_object_object_add(obj, (char*) "inputEvents", json_object_new_int(m_inputEvents));
+	json_object_object_add(obj, (char*) "coalescedInputEvents", json_object_new_int(m_coalescedInputEvents));
+	json_object_object_add(obj, (char*) "inputEventAllocations", json_object_new_int(m_inputEventAllocations));
+
+	m_renderTime.toJson(obj, "renderTime");
+	m_updateLatency.toJson(obj, "updateLatency");
+	m_inputLatency.toJson(obj, "inputLatency");
+}
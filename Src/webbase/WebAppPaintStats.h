@@ -0,0 +1,120 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef WEBAPPPAINTSTATS_H
+#define WEBAPPPAINTSTATS_H
+
+#include "Common.h"
+
+#include <stdint.h>
+
+struct json_object;
+
+/**
+ * Always-on paint counters for one window: render time and
+ * invalidation-to-update latency histograms, pixels, damage rects and
+ * paint frequency, plus input delivery latency. Cheap enough to update on
+ * every paint and event.
+ */
+class WebAppPaintStats
+{
+public:
+
+	WebAppPaintStats();
+
+	// a damage rect was reported by the page
+	void damageAdded();
+
+	// bracket the rendering of one frame
+	void paintStarted();
+	void paintFinished(int pixels);
+
+	// a frame rendered over several main loop iterations: the time between
+	// its slices doesn't count as render time
+	void paintSuspended();
+	void paintResumed();
+
+	// a paint was held back because the window isn't visible
+	void paintSuppressed();
+
+	// an update was hashed, and dropped if its content was unchanged
+	void updateHashed(bool unchanged);
+
+	// an input event reached the page latencyUs after it was received, standing
+	// in for merged events that were coalesced into it
+	void inputDelivered(uint64_t latencyUs, int merged);
+
+	// an Event had to be allocated to deliver input, only the first one
+	// should be in steady state
+	void inputEventAllocated();
+
+	// time (currentTimeUs) of the oldest damage that wasn't painted yet, 0 if none
+	uint64_t pendingDamageSinceUs() const { return m_firstPendingDamageUs; }
+
+	// adds the counters to obj
+	void toJson(json_object* obj) const;
+
+	static uint64_t currentTimeUs();
+
+	// upper bounds of the histogram buckets, the last bucket is open
+	static const int kNumBuckets = 8;
+	static const int kBucketLimitsMs[kNumBuckets - 1];
+
+private:
+
+	struct Histogram {
+		Histogram();
+		void add(uint64_t us);
+		void toJson(json_object* obj, const char* name) const;
+
+		uint32_t buckets[kNumBuckets];
+		uint32_t count;
+		uint64_t totalUs;
+		uint64_t maxUs;
+	};
+
+	Histogram m_renderTime;
+	Histogram m_updateLatency;
+	Histogram m_inputLatency;
+
+	uint32_t m_paints;
+	uint64_t m_pixels;
+	uint32_t m_damageRects;
+	uint32_t m_suppressedPaints;
+	uint32_t m_hashedUpdates;
+	uint32_t m_unchangedUpdates;
+	uint32_t m_inputEvents;
+	uint32_t m_coalescedInputEvents;
+	uint32_t m_inputEventAllocations;
+
+	uint64_t m_createdUs;
+	uint64_t m_paintStartUs;
+	uint64_t m_paintSegmentStartUs;	// 0 while suspended
+	uint64_t m_paintActiveUs;		// rendering before the current segment
+	uint64_t m_firstPendingDamageUs;
+
+	// paint rate over the last completed sampling period
+	uint64_t m_rateWindowStartUs;
+	uint32_t m_rateWindowPaints;
+	double m_recentPaintsPerSec;
+};
+
+#endif /* WEBAPPPAINTSTATS_H */
@@ -0,0 +1,87 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "WebAppRotateTransition.h"
+
+#include "PixelKernels.h"
+#include "Time.h"
+
+WebAppRotateTransition::WebAppRotateTransition(const QImage& surface, int angle, int durationMs)
+	: m_durationMs(durationMs)
+	, m_startTime(Time::curTimeMs())
+{
+	if (surface.format() != QImage::Format_ARGB32_Premultiplied &&
+		surface.format() != QImage::Format_RGB16)
+		return;
+
+	const int bytesPerPixel = surface.depth() / 8;
+	const int w = surface.width();
+	const int h = surface.height();
+
+	m_from = surface.copy();
+	m_to = QImage(w, h, surface.format());
+	if (m_from.isNull() || m_to.isNull()) {
+		m_from = QImage();
+		return;
+	}
+
+	// a quarter turn doesn't fit the buffer: turn the centered square and
+	// letterbox it in black
+	QRect turned(0, 0, w, h);
+	if (angle != 180) {
+		const int side = qMin(w, h);
+		turned = QRect((w - side) / 2, (h - side) / 2, side, side);
+
+		if (bytesPerPixel == sizeof(uint32_t))
+			PixelKernels::fill(m_to.bits(), m_to.bytesPerLine(), 0, 0, w, h, 0xFF000000);
+		else
+			PixelKernels::fill16(m_to.bits(), m_to.bytesPerLine(), 0, 0, w, h, 0x0000);
+	}
+
+	if (!PixelKernels::rotate(m_to.bits(), m_to.bytesPerLine(), turned.x(), turned.y(),
+							  m_from.constBits(), m_from.bytesPerLine(), turned.x(), turned.y(),
+							  turned.width(), turned.height(), bytesPerPixel, angle)) {
+		m_from = QImage();
+		m_to = QImage();
+	}
+}
+
+bool WebAppRotateTransition::paintFrame(QImage* surface)
+{
+	uint32_t elapsed = Time::curTimeMs() - m_startTime;
+	if (!isValid() || (int) elapsed >= m_durationMs)
+		return false;
+
+	if (surface->size() != m_from.size() || surface->format() != m_from.format())
+		return false;
+
+	// ease out: most of the change is visible right away
+	float t = (float) elapsed / m_durationMs;
+	int alpha = (int) ((1.0f - (1.0f - t) * (1.0f - t)) * 256);
+
+	return PixelKernels::crossfade(surface->bits(), surface->bytesPerLine(),
+								   m_from.constBits(), m_from.bytesPerLine(),
+								   m_to.constBits(), m_to.bytesPerLine(),
+								   surface->width(), surface->height(),
+								   surface->depth() / 8, alpha);
+}
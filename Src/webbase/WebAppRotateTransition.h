@@ -0,0 +1,61 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef WEBAPPROTATETRANSITION_H
+#define WEBAPPROTATETRANSITION_H
+
+#include "Common.h"
+
+#include <stdint.h>
+
+#include <QImage>
+
+/**
+ * Cheap software stand-in for an orientation change.
+ *
+ * Takes a snapshot of the last frame and a copy of it turned to the new
+ * orientation, then crossfades from one to the other, one frame per tick,
+ * while the page relays out. The owner swaps in the real content once
+ * paintFrame() reports the transition is over.
+ */
+class WebAppRotateTransition
+{
+public:
+
+	// surface holds the current frame, angle (90, 180 or 270) is how far the
+	// content turns clockwise
+	WebAppRotateTransition(const QImage& surface, int angle, int durationMs);
+
+	bool isValid() const { return !m_from.isNull() && !m_to.isNull(); }
+
+	// draws the frame for the current time into surface, which must match the
+	// snapshot. Returns false, without drawing, once the transition is over
+	bool paintFrame(QImage* surface);
+
+private:
+
+	QImage m_from;
+	QImage m_to;
+	int m_durationMs;
+	uint32_t m_startTime;
+};
+
+#endif /* WEBAPPROTATETRANSITION_H */
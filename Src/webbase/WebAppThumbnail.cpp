@@ -0,0 +1,155 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "WebAppThumbnail.h"
+
+#include <PIpcBuffer.h>
+
+#include "RemoteWindowData.h"
+#include "Time.h"
+#include "WindowMetaData.h"
+
+// refresh once this fraction (1 / n) of the window was damaged
+static const int kDamageFractionForUpdate = 8;
+// small damage doesn't leave the thumbnail stale for longer than this
+static const uint32_t kMaxStaleMs = 2000;
+
+WebAppThumbnail::WebAppThumbnail(PIpcBuffer* metaDataBuffer, int scale)
+	: m_metaDataBuffer(metaDataBuffer)
+	, m_buffer(0)
+	, m_bufferSize(0)
+	, m_scale(scale)
+	, m_width(0)
+	, m_height(0)
+	, m_pitch(0)
+	, m_windowPixels(0)
+	, m_damagedPixels(0)
+	, m_firstDamageTime(0)
+	, m_serial(0)
+{
+	if (m_scale != 2 && m_scale != 4 && m_scale != 8)
+		m_scale = kDefaultScale;
+}
+
+WebAppThumbnail::~WebAppThumbnail()
+{
+	delete m_buffer;
+}
+
+void WebAppThumbnail::damageAdded(int pixels)
+{
+	if (!m_damagedPixels)
+		m_firstDamageTime = Time::curTimeMs();
+
+	m_damagedPixels += pixels;
+}
+
+bool WebAppThumbnail::needsUpdate() const
+{
+	if (!m_serial)
+		return true;
+
+	if (!m_damagedPixels)
+		return false;
+
+	return m_damagedPixels >= m_windowPixels / kDamageFractionForUpdate ||
+		   Time::curTimeMs() - m_firstDamageTime >= kMaxStaleMs;
+}
+
+uint32_t WebAppThumbnail::msUntilStale() const
+{
+	if (!m_damagedPixels)
+		return 0;
+
+	uint32_t elapsed = Time::curTimeMs() - m_firstDamageTime;
+	return elapsed < kMaxStaleMs ? kMaxStaleMs - elapsed : 0;
+}
+
+bool WebAppThumbnail::update(RemoteWindowData* data)
+{
+	if (!data || !ensureBuffer(data->width(), data->height()))
+		return false;
+
+	m_buffer->lock();
+	bool ok = data->downscaleInto(m_buffer->data(), m_pitch, m_scale);
+	m_buffer->unlock();
+
+	if (!ok)
+		return false;
+
+	m_damagedPixels = 0;
+	m_serial++;
+	publish();
+
+	return true;
+}
+
+bool WebAppThumbnail::ensureBuffer(int windowWidth, int windowHeight)
+{
+	int width = windowWidth / m_scale;
+	int height = windowHeight / m_scale;
+	if (width <= 0 || height <= 0)
+		return false;
+
+	if (m_buffer && width == m_width && height == m_height)
+		return true;
+
+	int pitch = width * sizeof(uint32_t);
+	int size = pitch * height;
+
+	// the buffer only grows, the host gets the new dimensions with the next serial
+	if (size > m_bufferSize) {
+		PIpcBuffer* buffer = PIpcBuffer::create(size);
+		if (!buffer) {
+			g_warning("WebAppThumbnail: failed to allocate %d bytes", size);
+			return false;
+		}
+
+		delete m_buffer;
+		m_buffer = buffer;
+		m_bufferSize = size;
+	}
+
+	m_width = width;
+	m_height = height;
+	m_pitch = pitch;
+	m_windowPixels = windowWidth * windowHeight;
+
+	return true;
+}
+
+void WebAppThumbnail::publish()
+{
+	if (!m_metaDataBuffer)
+		return;
+
+	m_metaDataBuffer->lock();
+	WindowMetaData* metaData = (WindowMetaData*) m_metaDataBuffer->data();
+	metaData->thumbnailKey = m_buffer->key();
+	metaData->thumbnailWidth = m_width;
+	metaData->thumbnailHeight = m_height;
+	metaData->thumbnailPitch = m_pitch;
+	metaData->thumbnailScale = m_scale;
+	metaData->thumbnailSerial = m_serial;
+	m_metaDataBuffer->unlock();
+}
@@ -0,0 +1,92 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef WEBAPPTHUMBNAIL_H
+#define WEBAPPTHUMBNAIL_H
+
+#include "Common.h"
+
+#include <stdint.h>
+
+class PIpcBuffer;
+class RemoteWindowData;
+
+/**
+ * Small area averaged copy of a card, kept in its own shared buffer for the
+ * card switcher.
+ *
+ * The host finds the buffer through the window metadata (thumbnailKey and
+ * friends) and picks up a new image whenever thumbnailSerial changes. The
+ * thumbnail is only refreshed once enough of the window was damaged, and it
+ * outlives the window buffer, so a card that was frozen or lost its backing
+ * store can still be shown.
+ */
+class WebAppThumbnail
+{
+public:
+
+	// scale is the downscale factor, 2, 4 or 8
+	WebAppThumbnail(PIpcBuffer* metaDataBuffer, int scale = kDefaultScale);
+	~WebAppThumbnail();
+
+	// pixels of the window were reported as changed
+	void damageAdded(int pixels);
+
+	// true once the thumbnail is missing or the accumulated damage is worth a refresh
+	bool needsUpdate() const;
+
+	// damage not yet in the thumbnail, and how long until it's too stale to keep waiting
+	bool hasPendingDamage() const { return m_damagedPixels > 0; }
+	uint32_t msUntilStale() const;
+
+	// downscales the current contents of data. Call it outside of beginPaint/endPaint.
+	// Returns false if the window pixels can't be read
+	bool update(RemoteWindowData* data);
+
+	int memoryUsage() const { return m_bufferSize; }
+
+	static const int kDefaultScale = 4;
+
+private:
+
+	bool ensureBuffer(int windowWidth, int windowHeight);
+	void publish();
+
+	PIpcBuffer* m_metaDataBuffer;
+	PIpcBuffer* m_buffer;
+	int m_bufferSize;
+	int m_scale;
+	int m_width;
+	int m_height;
+	int m_pitch;
+	int m_windowPixels;
+
+	int m_damagedPixels;
+	uint32_t m_firstDamageTime;
+	uint32_t m_serial;
+
+private:
+
+	WebAppThumbnail(const WebAppThumbnail&);
+	WebAppThumbnail& operator=(const WebAppThumbnail&);
+};
+
+#endif /* WEBAPPTHUMBNAIL_H */
@@ -0,0 +1,274 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "WebAppTileCache.h"
+
+#include <list>
+
+#include <QPainter>
+
+#include "WindowedWebApp.h"
+
+// total tile memory for all windows, about 4 full screen cards
+static const int kMaxTileCacheBytes = 12 * 1024 * 1024;
+
+typedef std::list<WebAppTileCache*> TileCacheList;
+static TileCacheList s_caches;
+static int s_totalBytes = 0;
+static int s_budgetBytes = kMaxTileCacheBytes;
+
+WebAppTileCache::WebAppTileCache()
+	: m_columns(0)
+	, m_rows(0)
+	, m_format(QImage::Format_ARGB32_Premultiplied)
+	, m_bytes(0)
+	, m_paintSerial(0)
+{
+	s_caches.push_back(this);
+}
+
+WebAppTileCache::~WebAppTileCache()
+{
+	purge();
+	s_caches.remove(this);
+}
+
+void WebAppTileCache::invalidate(const QRect& rect)
+{
+	QRect r = rect & QRect(QPoint(0, 0), m_size);
+	if (r.isEmpty() || !m_bytes)
+		return;
+
+	for (int ty = r.top() / kTileSize; ty <= r.bottom() / kTileSize; ty++) {
+		for (int tx = r.left() / kTileSize; tx <= r.right() / kTileSize; tx++) {
+			Tile& tile = m_tiles[ty * m_columns + tx];
+			if (!tile.image)
+				continue;
+
+			QRect tileRect(tx * kTileSize, ty * kTileSize, kTileSize, kTileSize);
+			tile.dirty |= (r & tileRect).translated(-tileRect.topLeft());
+		}
+	}
+}
+
+void WebAppTileCache::invalidateAll()
+{
+	for (unsigned int i = 0; i < m_tiles.size(); i++) {
+		if (m_tiles[i].image)
+			m_tiles[i].dirty = QRect(0, 0, kTileSize, kTileSize);
+	}
+}
+
+bool WebAppTileCache::paint(QPainter* painter, const QRect& rect, WindowedWebApp* app)
+{
+	QPaintDevice* device = painter->device();
+	if (!device || device->devType() != QInternal::Image)
+		return false;
+
+	// tiles match the surface so composing them is a straight copy
+	QImage* surface = static_cast<QImage*>(device);
+	if (surface->size() != m_size || surface->format() != m_format)
+		reset(surface->size(), surface->format());
+
+	QRect r = rect & QRect(QPoint(0, 0), m_size);
+	if (r.isEmpty())
+		return true;
+
+	m_paintSerial++;
+
+	const int tx0 = r.left() / kTileSize;
+	const int tx1 = r.right() / kTileSize;
+	const int ty0 = r.top() / kTileSize;
+	const int ty1 = r.bottom() / kTileSize;
+
+	// get all the tiles first, so we never evict a tile this paint needs
+	for (int ty = ty0; ty <= ty1; ty++) {
+		for (int tx = tx0; tx <= tx1; tx++) {
+			Tile& tile = m_tiles[ty * m_columns + tx];
+			tile.lastUsed = m_paintSerial;
+			if (!tile.image && !allocateTile(tile))
+				return false;
+		}
+	}
+
+	for (int ty = ty0; ty <= ty1; ty++) {
+		for (int tx = tx0; tx <= tx1; tx++) {
+			Tile& tile = m_tiles[ty * m_columns + tx];
+			QRect tileRect(tx * kTileSize, ty * kTileSize, kTileSize, kTileSize);
+
+			if (!tile.dirty.isEmpty()) {
+				QRect dirty = tile.dirty.translated(tileRect.topLeft()) & QRect(QPoint(0, 0), m_size);
+
+				QPainter tilePainter(tile.image);
+				tilePainter.setCompositionMode(QPainter::CompositionMode_Source);
+				tilePainter.translate(-tileRect.left(), -tileRect.top());
+				tilePainter.setClipRect(dirty);
+				if (!app->opaqueContent())
+					tilePainter.fillRect(dirty, Qt::transparent);
+				app->renderContents(&tilePainter, dirty);
+				tilePainter.end();
+
+				tile.dirty = QRect();
+			}
+
+			QRect part = tileRect & r;
+			painter->drawImage(part.topLeft(), *tile.image, part.translated(-tileRect.topLeft()));
+		}
+	}
+
+	return true;
+}
+
+void WebAppTileCache::purge()
+{
+	for (unsigned int i = 0; i < m_tiles.size(); i++)
+		freeTile(m_tiles[i]);
+}
+
+void WebAppTileCache::reset(const QSize& size, QImage::Format format)
+{
+	purge();
+
+	m_size = size;
+	m_format = format;
+	m_columns = (size.width() + kTileSize - 1) / kTileSize;
+	m_rows = (size.height() + kTileSize - 1) / kTileSize;
+	m_tiles.assign(m_columns * m_rows, Tile());
+}
+
+int WebAppTileCache::tileBytes() const
+{
+	return kTileSize * kTileSize * (m_format == QImage::Format_RGB16 ? 2 : 4);
+}
+
+bool WebAppTileCache::allocateTile(Tile& tile)
+{
+	const int bytes = tileBytes();
+	if (!makeRoom(this, bytes))
+		return false;
+
+	tile.image = new QImage(kTileSize, kTileSize, m_format);
+	if (tile.image->isNull()) {
+		delete tile.image;
+		tile.image = 0;
+		return false;
+	}
+
+	tile.dirty = QRect(0, 0, kTileSize, kTileSize);
+	m_bytes += bytes;
+	s_totalBytes += bytes;
+
+	return true;
+}
+
+void WebAppTileCache::freeTile(Tile& tile)
+{
+	if (!tile.image)
+		return;
+
+	delete tile.image;
+	tile.image = 0;
+	tile.dirty = QRect();
+
+	m_bytes -= tileBytes();
+	s_totalBytes -= tileBytes();
+}
+
+int WebAppTileCache::releaseTiles(int bytesNeeded, bool includeCurrentPaint)
+{
+	int freed = 0;
+
+	// least recently used first
+	while (freed < bytesNeeded) {
+		Tile* oldest = 0;
+		for (unsigned int i = 0; i < m_tiles.size(); i++) {
+			Tile& tile = m_tiles[i];
+			if (!tile.image)
+				continue;
+			if (!includeCurrentPaint && tile.lastUsed == m_paintSerial)
+				continue;
+			if (!oldest || tile.lastUsed < oldest->lastUsed)
+				oldest = &tile;
+		}
+
+		if (!oldest)
+			break;
+
+		freed += tileBytes();
+		freeTile(*oldest);
+	}
+
+	return freed;
+}
+
+bool WebAppTileCache::makeRoom(WebAppTileCache* requester, int bytes)
+{
+	if (bytes > s_budgetBytes)
+		return false;
+
+	int needed = s_totalBytes + bytes - s_budgetBytes;
+	if (needed <= 0)
+		return true;
+
+	// give up our own stale tiles before taking them away from other windows
+	needed -= requester->releaseTiles(needed, false);
+
+	for (TileCacheList::iterator it = s_caches.begin();
+		 it != s_caches.end() && needed > 0; ++it) {
+		if (*it != requester)
+			needed -= (*it)->releaseTiles(needed, true);
+	}
+
+	return needed <= 0;
+}
+
+void WebAppTileCache::trimToBudget()
+{
+	for (TileCacheList::iterator it = s_caches.begin();
+		 it != s_caches.end() && s_totalBytes > s_budgetBytes; ++it) {
+		(*it)->releaseTiles(s_totalBytes - s_budgetBytes, true);
+	}
+}
+
+void WebAppTileCache::memoryStateChanged(MemoryWatcher::MemState state)
+{
+	switch (state) {
+	case MemoryWatcher::Normal:
+		s_budgetBytes = kMaxTileCacheBytes;
+		break;
+	case MemoryWatcher::Medium:
+		s_budgetBytes = kMaxTileCacheBytes / 2;
+		break;
+	default:
+		// Low/Critical: windows render directly until memory recovers
+		s_budgetBytes = 0;
+		break;
+	}
+
+	int oldBytes = s_totalBytes;
+	trimToBudget();
+
+	if (oldBytes != s_totalBytes)
+		g_message("WebAppTileCache: released %d KB of tiles, %d KB in use",
+				  (oldBytes - s_totalBytes) / 1024, s_totalBytes / 1024);
+}
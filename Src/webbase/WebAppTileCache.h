@@ -0,0 +1,104 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef WEBAPPTILECACHE_H
+#define WEBAPPTILECACHE_H
+
+#include "Common.h"
+
+#include <vector>
+
+#include <QImage>
+#include <QRect>
+
+#include "MemoryWatcher.h"
+
+class QPainter;
+class WindowedWebApp;
+
+/**
+ * Caches rendered window contents in fixed size tiles.
+ *
+ * Damage reported by the page only marks the tiles it touches. A paint then
+ * re-renders the damaged part of those tiles and composes the requested rect
+ * from the tiles, so repaints of unchanged content are plain copies.
+ *
+ * Tile memory is shared by all caches, bounded, and handed back when the
+ * memory state gets worse.
+ */
+class WebAppTileCache
+{
+public:
+
+	WebAppTileCache();
+	~WebAppTileCache();
+
+	// mark content in rect (surface coordinates) as changed
+	void invalidate(const QRect& rect);
+	void invalidateAll();
+
+	// brings the tiles covering rect up to date through app->renderContents and
+	// draws them into painter, which must be open on the window surface. Returns
+	// false if there is no tile memory, the caller then renders directly
+	bool paint(QPainter* painter, const QRect& rect, WindowedWebApp* app);
+
+	// frees all tiles of this cache
+	void purge();
+
+	int memoryUsage() const { return m_bytes; }
+
+	static void memoryStateChanged(MemoryWatcher::MemState state);
+
+	static const int kTileSize = 256;
+
+private:
+
+	struct Tile {
+		Tile() : image(0), lastUsed(0) {}
+		QImage* image;
+		QRect dirty;		// in tile coordinates
+		uint32_t lastUsed;
+	};
+
+	void reset(const QSize& size, QImage::Format format);
+	bool allocateTile(Tile& tile);
+	void freeTile(Tile& tile);
+	int releaseTiles(int bytesNeeded, bool includeCurrentPaint);
+	int tileBytes() const;
+
+	static bool makeRoom(WebAppTileCache* requester, int bytes);
+	static void trimToBudget();
+
+	std::vector<Tile> m_tiles;
+	int m_columns;
+	int m_rows;
+	QSize m_size;
+	QImage::Format m_format;
+	int m_bytes;
+	uint32_t m_paintSerial;
+
+private:
+
+	WebAppTileCache(const WebAppTileCache&);
+	WebAppTileCache& operator=(const WebAppTileCache&);
+};
+
+#endif /* WEBAPPTILECACHE_H */
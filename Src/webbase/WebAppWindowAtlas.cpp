@@ -0,0 +1,218 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "WebAppWindowAtlas.h"
+
+#include <list>
+
+#include <PIpcBuffer.h>
+
+// shelf heights are rounded up to this, so windows of about the same
+// height share a shelf
+static const int kShelfAlign = 8;
+
+typedef std::list<WebAppWindowAtlas*> AtlasList;
+static AtlasList s_atlases;
+
+WebAppWindowAtlas* WebAppWindowAtlas::allocate(int width, int height, QRect& rect)
+{
+	if (width <= 0 || height <= 0)
+		return 0;
+
+	for (AtlasList::iterator it = s_atlases.begin(); it != s_atlases.end(); ++it) {
+		if ((*it)->allocateRect(width, height, rect))
+			return *it;
+	}
+
+	// windows bigger than a page get a page of their own size
+	WebAppWindowAtlas* atlas = new WebAppWindowAtlas(qMax((int) kPageWidth, width),
+													 qMax((int) kPageHeight, height));
+	if (!atlas->m_buffer || !atlas->allocateRect(width, height, rect)) {
+		g_warning("WebAppWindowAtlas: failed to create a %dx%d page", atlas->m_width, atlas->m_height);
+		delete atlas;
+		return 0;
+	}
+
+	s_atlases.push_back(atlas);
+	g_debug("WebAppWindowAtlas: new %dx%d page, %d pages in use",
+			atlas->m_width, atlas->m_height, (int) s_atlases.size());
+
+	return atlas;
+}
+
+void WebAppWindowAtlas::release(WebAppWindowAtlas* atlas, const QRect& rect)
+{
+	if (!atlas)
+		return;
+
+	atlas->releaseRect(rect);
+	if (atlas->m_windows)
+		return;
+
+	s_atlases.remove(atlas);
+	delete atlas;
+}
+
+WebAppWindowAtlas::WebAppWindowAtlas(int width, int height)
+	: m_buffer(0)
+	, m_width(width)
+	, m_height(height)
+	, m_windows(0)
+	, m_shelfBottom(0)
+{
+	// pages are never cleared as a whole, each window fills its own rect.
+	// pixels nobody touched don't cost memory
+	m_buffer = PIpcBuffer::create(pitch() * m_height);
+}
+
+WebAppWindowAtlas::~WebAppWindowAtlas()
+{
+	delete m_buffer;
+}
+
+bool WebAppWindowAtlas::allocateRect(int width, int height, QRect& rect)
+{
+	if (width > m_width || height > m_height)
+		return false;
+
+	const int shelfHeight = (height + kShelfAlign - 1) & ~(kShelfAlign - 1);
+
+	// best fit: the lowest shelf with room that is tall enough, without
+	// wasting more than a quarter of it. Empty shelves take anything that fits
+	int best = -1;
+	unsigned int bestSpan = 0;
+	for (unsigned int i = 0; i < m_shelves.size(); i++) {
+		const Shelf& shelf = m_shelves[i];
+		if (shelf.height < height)
+			continue;
+		if (shelf.windows && shelf.height > shelfHeight + shelfHeight / 4)
+			continue;
+		if (best >= 0 && shelf.height >= m_shelves[best].height)
+			continue;
+
+		for (unsigned int j = 0; j < shelf.free.size(); j++) {
+			if (shelf.free[j].width >= width) {
+				best = i;
+				bestSpan = j;
+				break;
+			}
+		}
+	}
+
+	if (best < 0) {
+		// the last shelf may be cut short by the bottom of the page
+		const int newHeight = qMin(shelfHeight, m_height - m_shelfBottom);
+		if (newHeight < height)
+			return false;
+
+		Shelf shelf;
+		shelf.y = m_shelfBottom;
+		shelf.height = newHeight;
+		resetShelf(shelf);
+		m_shelves.push_back(shelf);
+		m_shelfBottom += newHeight;
+
+		best = m_shelves.size() - 1;
+		bestSpan = 0;
+	}
+
+	Shelf& shelf = m_shelves[best];
+	Span& span = shelf.free[bestSpan];
+
+	rect = QRect(span.x, shelf.y, width, height);
+
+	span.x += width;
+	span.width -= width;
+	if (!span.width)
+		shelf.free.erase(shelf.free.begin() + bestSpan);
+
+	shelf.windows++;
+	m_windows++;
+
+	return true;
+}
+
+void WebAppWindowAtlas::releaseRect(const QRect& rect)
+{
+	for (unsigned int i = 0; i < m_shelves.size(); i++) {
+		Shelf& shelf = m_shelves[i];
+		if (shelf.y != rect.y())
+			continue;
+
+		shelf.windows--;
+		m_windows--;
+
+		if (!shelf.windows) {
+			resetShelf(shelf);
+			trimShelves();
+			return;
+		}
+
+		// put the span back in order and merge it with its neighbours
+		std::vector<Span>::iterator it = shelf.free.begin();
+		while (it != shelf.free.end() && it->x < rect.x())
+			++it;
+
+		Span span;
+		span.x = rect.x();
+		span.width = rect.width();
+		it = shelf.free.insert(it, span);
+
+		std::vector<Span>::iterator next = it + 1;
+		if (next != shelf.free.end() && it->x + it->width == next->x) {
+			it->width += next->width;
+			shelf.free.erase(next);
+		}
+
+		if (it != shelf.free.begin()) {
+			std::vector<Span>::iterator prev = it - 1;
+			if (prev->x + prev->width == it->x) {
+				prev->width += it->width;
+				shelf.free.erase(it);
+			}
+		}
+		return;
+	}
+
+	g_warning("WebAppWindowAtlas: releasing unknown rect %d,%d %dx%d",
+			  rect.x(), rect.y(), rect.width(), rect.height());
+}
+
+void WebAppWindowAtlas::resetShelf(Shelf& shelf)
+{
+	Span span;
+	span.x = 0;
+	span.width = m_width;
+
+	shelf.windows = 0;
+	shelf.free.assign(1, span);
+}
+
+void WebAppWindowAtlas::trimShelves()
+{
+	// empty shelves at the bottom go back to the page so it can hold taller ones
+	while (!m_shelves.empty() && !m_shelves.back().windows) {
+		m_shelfBottom = m_shelves.back().y;
+		m_shelves.pop_back();
+	}
+}
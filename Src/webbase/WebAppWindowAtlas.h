@@ -0,0 +1,95 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef WEBAPPWINDOWATLAS_H
+#define WEBAPPWINDOWATLAS_H
+
+#include "Common.h"
+
+#include <stdint.h>
+#include <vector>
+
+#include <QRect>
+
+class PIpcBuffer;
+
+/**
+ * One shared 32bpp buffer holding the pixels of several small windows.
+ *
+ * Dashboards and alerts are small and there are often many of them, so a
+ * buffer each mostly costs mappings, file descriptors and page rounding.
+ * Instead they get a rect in an atlas page. Rects are packed into shelves
+ * (rows of similar height), closing a window hands its span back to the
+ * shelf right away, and a page with no windows left is freed.
+ */
+class WebAppWindowAtlas
+{
+public:
+
+	// reserves a width x height rect in one of the pages, creating a page if
+	// none has room. Returns 0 if there is no memory for a new page
+	static WebAppWindowAtlas* allocate(int width, int height, QRect& rect);
+
+	// gives back a rect returned by allocate(). The page may be deleted
+	static void release(WebAppWindowAtlas* atlas, const QRect& rect);
+
+	PIpcBuffer* buffer() const { return m_buffer; }
+	int pitch() const { return m_width * sizeof(uint32_t); }
+
+	static const int kPageWidth = 1024;
+	static const int kPageHeight = 512;
+
+private:
+
+	WebAppWindowAtlas(int width, int height);
+	~WebAppWindowAtlas();
+
+	struct Span {
+		int x;
+		int width;
+	};
+
+	struct Shelf {
+		int y;
+		int height;
+		int windows;
+		std::vector<Span> free;		// sorted by x
+	};
+
+	bool allocateRect(int width, int height, QRect& rect);
+	void releaseRect(const QRect& rect);
+	void resetShelf(Shelf& shelf);
+	void trimShelves();
+
+	PIpcBuffer* m_buffer;
+	int m_width;
+	int m_height;
+	int m_windows;
+	int m_shelfBottom;
+	std::vector<Shelf> m_shelves;	// sorted by y
+
+private:
+
+	WebAppWindowAtlas(const WebAppWindowAtlas&);
+	WebAppWindowAtlas& operator=(const WebAppWindowAtlas&);
+};
+
+#endif /* WEBAPPWINDOWATLAS_H */
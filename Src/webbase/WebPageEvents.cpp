@@ -0,0 +1,120 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "WebPageEvents.h"
+
+#include <QWebPage>
+#include <QWebFrame>
+
+// forwards the signals of window.__palmEvents to the Mojo callbacks. Mojo is
+// looked up on every event, the framework may be loaded after the shim
+static const char* kEventShimScript =
+	"(function() {"
+	"  var e = window.__palmEvents;"
+	"  if (!e || window.__palmEventsShim)"
+	"    return;"
+	"  window.__palmEventsShim = true;"
+	"  function mojo(name) {"
+	"    return (window.Mojo && typeof Mojo[name] == 'function') ? Mojo : null;"
+	"  }"
+	"  e.gestureEvent.connect(function(type, args) {"
+	"    var m = mojo('handleGesture');"
+	"    if (m) m.handleGesture(type, args);"
+	"  });"
+	"  e.showRequested.connect(function() {"
+	"    var m = mojo('show');"
+	"    if (m) m.show();"
+	"  });"
+	"  e.hideRequested.connect(function() {"
+	"    var m = mojo('hide');"
+	"    if (m) m.hide();"
+	"  });"
+	"  e.stageActivationChanged.connect(function(activated) {"
+	"    var name = activated ? 'stageActivated' : 'stageDeactivated';"
+	"    var m = mojo(name);"
+	"    if (m) m[name]();"
+	"  });"
+	"  e.relaunchRequested.connect(function() {"
+	"    var m = mojo('relaunch');"
+	"    e.setRelaunchResult(m ? !!m.relaunch() : false);"
+	"  });"
+	"})();";
+
+WebPageEvents::WebPageEvents(QWebPage* page, QObject* parent)
+	: QObject(parent)
+	, m_page(page)
+	, m_relaunchResult(false)
+{
+}
+
+void WebPageEvents::windowObjectCleared()
+{
+	if (!m_page)
+		return;
+
+	QWebFrame* frame = m_page->mainFrame();
+	frame->addToJavaScriptWindowObject("__palmEvents", this);
+	frame->evaluateJavaScript(kEventShimScript);
+}
+
+void WebPageEvents::flick(int x, int y, uint32_t timeStamp, int xVel, int yVel)
+{
+	QVariantMap args;
+	args.insert("x", x);
+	args.insert("y", y);
+	args.insert("timeStamp", timeStamp);
+	args.insert("xVel", xVel);
+	args.insert("yVel", yVel);
+
+	Q_EMIT gestureEvent("flick", args);
+}
+
+void WebPageEvents::show()
+{
+	Q_EMIT showRequested();
+}
+
+void WebPageEvents::hide()
+{
+	Q_EMIT hideRequested();
+}
+
+void WebPageEvents::stageActivated(bool activated)
+{
+	Q_EMIT stageActivationChanged(activated);
+}
+
+bool WebPageEvents::relaunch()
+{
+	// the shim answers synchronously, from within the emission
+	m_relaunchResult = false;
+	Q_EMIT relaunchRequested();
+
+	return m_relaunchResult;
+}
+
+void WebPageEvents::setRelaunchResult(bool result)
+{
+	m_relaunchResult = result;
+}
+
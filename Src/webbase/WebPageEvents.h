@@ -0,0 +1,89 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef WEBPAGEEVENTS_H
+#define WEBPAGEEVENTS_H
+
+#include "Common.h"
+
+#include <stdint.h>
+
+#include <QObject>
+#include <QString>
+#include <QVariantMap>
+
+class QWebPage;
+
+/**
+ * Delivers system events to the script of a page.
+ *
+ * The object is exposed to the main frame of app pages loaded from the
+ * device as window.__palmEvents, remote content never gets it. A shim
+ * connected to its signals once per document forwards each of them to the
+ * matching Mojo callback, if the page has one. Sending an event is then a
+ * signal emission with typed arguments, instead of a script that has to be
+ * generated and compiled for every call.
+ */
+class WebPageEvents : public QObject
+{
+	Q_OBJECT
+
+public:
+
+	WebPageEvents(QWebPage* page, QObject* parent = 0);
+
+	// exposes the object and connects the shim, call when the main frame's
+	// window object was cleared
+	void windowObjectCleared();
+
+	// Mojo.handleGesture('flick', {x, y, timeStamp, xVel, yVel})
+	void flick(int x, int y, uint32_t timeStamp, int xVel, int yVel);
+
+	// Mojo.show() and Mojo.hide()
+	void show();
+	void hide();
+
+	// Mojo.stageActivated() and Mojo.stageDeactivated()
+	void stageActivated(bool activated);
+
+	// Mojo.relaunch(), returns what it returned
+	bool relaunch();
+
+public Q_SLOTS:
+
+	// called by the shim with the result of Mojo.relaunch()
+	void setRelaunchResult(bool result);
+
+Q_SIGNALS:
+
+	void gestureEvent(const QString& type, const QVariantMap& args);
+	void showRequested();
+	void hideRequested();
+	void stageActivationChanged(bool activated);
+	void relaunchRequested();
+
+private:
+
+	QWebPage* m_page;
+	bool m_relaunchResult;
+};
+
+#endif /* WEBPAGEEVENTS_H */
@@ -0,0 +1,237 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#include "Common.h"
+
+#include "WebPageThrottle.h"
+
+#include <stdlib.h>
+
+#include <QWebPage>
+#include <QWebFrame>
+#include <QVariant>
+
+#include <cjson/json.h>
+
+// shortest timer interval of a background page
+static const int kBackgroundMinTimerIntervalMs = 1000;
+
+// wraps the timer and animation frame functions of the window. every page
+// timer is kept in a table and backed by a native timer, which is re-armed
+// whenever the state changes: while throttled at an interval clamped to
+// minDelay, and animation frames become timers. while frozen no native timer
+// runs at all, on thaw due timeouts run once and intervals start over.
+// wakeups are counted per state, heldBack counts the runs a freeze skipped
+static const char* kTimerHooksScript =
+	"(function() {"
+	"  if (window.__palmThrottle)"
+	"    return;"
+	"  var t = { state: 0, minDelay: 0, wakeups: [0, 0, 0], heldBack: 0 };"
+	"  var timers = {};"
+	"  var timerSerial = 0;"
+	"  var frozenAt = 0;"
+	"  var nativeSetTimeout = window.setTimeout;"
+	"  var nativeSetInterval = window.setInterval;"
+	"  var nativeClearTimeout = window.clearTimeout;"
+	"  var nativeClearInterval = window.clearInterval;"
+	"  var nativeRaf = window.requestAnimationFrame || window.webkitRequestAnimationFrame;"
+	"  var nativeCancelRaf = window.cancelAnimationFrame || window.webkitCancelAnimationFrame;"
+	"  var rafs = {};"
+	"  var rafSerial = 1 << 30;"
+	"  function call(fn, self, args) {"
+	"    t.wakeups[t.state]++;"
+	"    if (typeof fn == 'function')"
+	"      fn.apply(self, args);"
+	"    else"
+	"      window.eval(String(fn));"
+	"  }"
+	"  function arm(id, h) {"
+	"    if (t.state == 2)"
+	"      return;"
+	"    var delay = h.delay;"
+	"    if (t.state && delay < t.minDelay)"
+	"      delay = t.minDelay;"
+	"    if (h.repeat) {"
+	"      h.native = nativeSetInterval.call(window, function() { call(h.fn, h.self, h.args); }, delay);"
+	"      return;"
+	"    }"
+	"    h.native = nativeSetTimeout.call(window, function() {"
+	"      delete timers[id];"
+	"      call(h.fn, h.self, h.args);"
+	"    }, Math.max(h.start + delay - Date.now(), 0));"
+	"  }"
+	"  function disarm(h) {"
+	"    if (h.native == null)"
+	"      return;"
+	"    (h.repeat ? nativeClearInterval : nativeClearTimeout).call(window, h.native);"
+	"    h.native = null;"
+	"  }"
+	"  function add(self, fn, delay, args, repeat) {"
+	"    var id = ++timerSerial;"
+	"    timers[id] = { fn: fn, self: self, args: args, delay: Math.max(+delay || 0, 0),"
+	"                   repeat: repeat, start: Date.now(), native: null };"
+	"    arm(id, timers[id]);"
+	"    return id;"
+	"  }"
+	"  window.setTimeout = function(fn, delay) {"
+	"    return add(this, fn, delay, Array.prototype.slice.call(arguments, 2), false);"
+	"  };"
+	"  window.setInterval = function(fn, delay) {"
+	"    return add(this, fn, delay, Array.prototype.slice.call(arguments, 2), true);"
+	"  };"
+	"  window.clearTimeout = window.clearInterval = function(id) {"
+	"    var h = timers[id];"
+	"    if (!h)"
+	"      return;"
+	"    disarm(h);"
+	"    delete timers[id];"
+	"  };"
+	"  if (nativeRaf) {"
+	"    window.requestAnimationFrame = window.webkitRequestAnimationFrame = function(fn) {"
+	"      if (!t.state)"
+	"        return nativeRaf.call(window, fn);"
+	"      var id = ++rafSerial;"
+	"      rafs[id] = window.setTimeout(function() { delete rafs[id]; fn(Date.now()); }, t.minDelay);"
+	"      return id;"
+	"    };"
+	"    window.cancelAnimationFrame = window.webkitCancelAnimationFrame = function(id) {"
+	"      if (rafs[id]) {"
+	"        window.clearTimeout(rafs[id]);"
+	"        delete rafs[id];"
+	"      }"
+	"      else if (nativeCancelRaf) {"
+	"        nativeCancelRaf.call(window, id);"
+	"      }"
+	"    };"
+	"  }"
+	"  t.set = function(state, minDelay) {"
+	"    var thawed = t.state == 2 && state != 2;"
+	"    var now = Date.now();"
+	"    if (state == 2 && t.state != 2)"
+	"      frozenAt = now;"
+	"    t.state = state;"
+	"    t.minDelay = minDelay;"
+	"    var style = document.getElementById('__palmThrottleStyle');"
+	"    var parent = document.head || document.documentElement;"
+	"    if (state && !style && parent) {"
+	"      style = document.createElement('style');"
+	"      style.id = '__palmThrottleStyle';"
+	"      style.textContent = '*, *:before, *:after { -webkit-animation-play-state: paused !important; }';"
+	"      parent.appendChild(style);"
+	"    }"
+	"    else if (!state && style) {"
+	"      style.parentNode.removeChild(style);"
+	"    }"
+	"    for (var id in timers) {"
+	"      var h = timers[id];"
+	"      disarm(h);"
+	"      if (thawed && h.repeat)"
+	"        t.heldBack += Math.floor((now - frozenAt) / Math.max(h.delay, 1));"
+	"      else if (thawed && h.start + h.delay <= now)"
+	"        t.heldBack++;"
+	"      arm(id, h);"
+	"    }"
+	"  };"
+	"  window.__palmThrottle = t;"
+	"})();";
+
+WebPageThrottle::WebPageThrottle(QWebPage* page)
+	: m_page(page)
+	, m_state(Active)
+	, m_stateChanges(0)
+	, m_enabled(::getenv("LUNA_DISABLE_PAGE_THROTTLE") == 0)
+{
+}
+
+void WebPageThrottle::setState(State state)
+{
+	if (state == m_state)
+		return;
+
+	m_state = state;
+	m_stateChanges++;
+
+	if (!m_enabled || !m_page)
+		return;
+
+#if (QT_VERSION >= QT_VERSION_CHECK(5, 0, 0))
+	// lets WebKit stop animation frames itself, and the page see it is hidden
+	m_page->setVisibilityState(state == Active ? QWebPage::VisibilityStateVisible
+											   : QWebPage::VisibilityStateHidden);
+#endif
+
+	applyToScript();
+}
+
+void WebPageThrottle::windowObjectCleared()
+{
+	if (!m_enabled || !m_page)
+		return;
+
+	m_page->mainFrame()->evaluateJavaScript(kTimerHooksScript);
+
+	// a new document starts in the state of the page
+	if (m_state != Active)
+		applyToScript();
+}
+
+void WebPageThrottle::applyToScript()
+{
+	int minDelay = (m_state == Active) ? 0 : kBackgroundMinTimerIntervalMs;
+
+	m_page->mainFrame()->evaluateJavaScript(
+		QString("if (window.__palmThrottle) __palmThrottle.set(%1, %2);").arg((int) m_state).arg(minDelay));
+}
+
+void WebPageThrottle::toJson(json_object* obj) const
+{
+	json_object_object_add(obj, (char*) "throttleState", json_object_new_string(stateName(m_state)));
+	json_object_object_add(obj, (char*) "throttleStateChanges", json_object_new_int(m_stateChanges));
+
+	if (!m_enabled || !m_page)
+		return;
+
+	QVariantList counters = m_page->mainFrame()->evaluateJavaScript(
+		"window.__palmThrottle ? __palmThrottle.wakeups.concat(__palmThrottle.heldBack) : []").toList();
+	if (counters.size() != Frozen + 2)
+		return;
+
+	json_object* wakeups = json_object_new_object();
+	for (int i = Active; i <= Frozen; i++)
+		json_object_object_add(wakeups, (char*) stateName((State) i), json_object_new_int(counters[i].toInt()));
+
+	json_object_object_add(obj, (char*) "timerWakeups", wakeups);
+	json_object_object_add(obj, (char*) "heldBackWakeups", json_object_new_int(counters[Frozen + 1].toInt()));
+}
+
+const char* WebPageThrottle::stateName(State state)
+{
+	switch (state) {
+	case Active:
+		return "active";
+	case Background:
+		return "background";
+	case Frozen:
+		return "frozen";
+	}
+
+	return "unknown";
+}
@@ -0,0 +1,84 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+
+
+
+#ifndef WEBPAGETHROTTLE_H
+#define WEBPAGETHROTTLE_H
+
+#include "Common.h"
+
+#include <stdint.h>
+
+class QWebPage;
+struct json_object;
+
+/**
+ * Slows down the script of a page while its output isn't looked at.
+ *
+ * Active pages run unrestricted. Background pages are reported hidden through
+ * the page visibility API (Qt 5), their timers and animation frames are
+ * clamped to one per second and their CSS animations are paused. Frozen pages
+ * hold all timers back until they are active or background again.
+ *
+ * QtWebKit has no public timer throttling, so the clamping is done by hooks
+ * around the timer functions of the main frame, installed whenever its window
+ * object is cleared. The hooks keep track of the page's timers and re-arm
+ * the native ones on every state change, so a throttled page really wakes up
+ * less often and a frozen one not at all. They also count the wakeups.
+ */
+class WebPageThrottle
+{
+public:
+
+	enum State {
+		Active = 0,
+		Background,
+		Frozen
+	};
+
+	WebPageThrottle(QWebPage* page);
+
+	void setState(State state);
+	State state() const { return m_state; }
+
+	// installs the timer hooks, call when the main frame's window object was cleared
+	void windowObjectCleared();
+
+	// adds the state and wakeup counters to obj
+	void toJson(json_object* obj) const;
+
+	static const char* stateName(State state);
+
+private:
+
+	void applyToScript();
+
+	QWebPage* m_page;
+	State m_state;
+	uint32_t m_stateChanges;
+	bool m_enabled;
+
+private:
+
+	WebPageThrottle(const WebPageThrottle&);
+	WebPageThrottle& operator=(const WebPageThrottle&);
+};
+
+#endif /* WEBPAGETHROTTLE_H */
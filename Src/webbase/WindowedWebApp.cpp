@@ -34,13 +34,20 @@
 #include "SysMgrWebBridge.h"
 #include "RemoteWindowData.h"
 #include "Settings.h"
+#include "ThreadPriorityManager.h"
 #include "Time.h"
 #include "Utils.h"
 #include "WebAppManager.h"
+#include "WebAppThumbnail.h"
+#include "WebAppTileCache.h"
 #include "WebKitKeyMap.h"
+#include "WebPageEvents.h"
+#include "WebPageThrottle.h"
 #include "WindowMetaData.h"
 
 #include <QDebug>
+#include <QHash>
+#include <QWebElement>
 
 #define MESSAGES_INTERNAL_FILE "SysMgrMessagesInternal.h"
 #include <PIpcMessageMacros.h>
@@ -51,12 +58,124 @@ static const int kMinAllowedIntervalGestureEndToSingleTap = 500;
 static const int kNumRecordedGestures = 5;
 static const int s_recordedGestureAvgWeights[] = { 1, 2, 4, 8, 16 };
 
+// damage of at least this many pixels is rendered in bands
+static const int kPaintSliceMinPixels = 512 * 512;
+static const int kPaintSliceHeight = 64;
+// how long one slice may keep the main loop busy
+static const uint32_t kPaintSliceBudgetMs = 8;
+
+// how often a window holding back paints checks whether the host shows it
+// again: the interval doubles on every check that finds it still hidden
+static const int kHostVisibilityPollMs = 250;
+static const int kHostVisibilityMaxPollMs = 4000;
+
+// input keeps the main thread at input priority for this long after each event
+static const uint32_t kInputPriorityMs = 250;
+
+// pen events that go to the page as mouse events
+struct PenEventTranslation {
+	Event::Type type;
+	QEvent::Type qtType;
+	Qt::MouseButton button;
+	Qt::MouseButtons buttons;
+};
+
+static const PenEventTranslation kPenEventTranslations[] = {
+	{ Event::PenDown, QEvent::MouseButtonPress, Qt::LeftButton, Qt::LeftButton },
+	{ Event::PenUp, QEvent::MouseButtonRelease, Qt::LeftButton, Qt::LeftButton },
+	{ Event::PenMove, QEvent::MouseMove, Qt::NoButton, Qt::NoButton }
+};
+
+static const PenEventTranslation* PrvPenEventTranslation(int type)
+{
+	for (unsigned int i = 0; i < G_N_ELEMENTS(kPenEventTranslations); i++) {
+		if (kPenEventTranslations[i].type == type)
+			return &kPenEventTranslations[i];
+	}
+
+	return 0;
+}
+
+// keyboard layout for an editable element, from x-palm-input-type or type
+static PalmIME::FieldType PrvEditorFieldType(const QWebElement& element)
+{
+	typedef QHash<QString, PalmIME::FieldType> FieldTypeHash;
+
+	static FieldTypeHash s_fieldTypes;
+	if (G_UNLIKELY(s_fieldTypes.isEmpty())) {
+		s_fieldTypes.insert("text", PalmIME::FieldType_Text);
+		s_fieldTypes.insert("password", PalmIME::FieldType_Password);
+		s_fieldTypes.insert("search", PalmIME::FieldType_Search);
+		s_fieldTypes.insert("range", PalmIME::FieldType_Range);
+		s_fieldTypes.insert("email", PalmIME::FieldType_Email);
+		s_fieldTypes.insert("number", PalmIME::FieldType_Number);
+		s_fieldTypes.insert("tel", PalmIME::FieldType_Phone);
+		s_fieldTypes.insert("itel", PalmIME::FieldType_Phone);
+		s_fieldTypes.insert("url", PalmIME::FieldType_URL);
+		s_fieldTypes.insert("color", PalmIME::FieldType_Color);
+	}
+
+	QString inputType = element.attribute("x-palm-input-type");
+	if (inputType.isEmpty())
+		inputType = element.attribute("type");
+
+	return s_fieldTypes.value(inputType.toLower(), PalmIME::FieldType_Text);
+}
+
+// input types that take no text, the keyboard isn't needed for them
+static const char* const kNonTextInputTypes[] = {
+	"button", "checkbox", "color", "file", "hidden", "image", "radio", "range", "reset", "submit"
+};
+
+static bool PrvIsEditable(const QWebElement& element)
+{
+	if (element.isNull())
+		return false;
+
+	QString tag = element.tagName().toLower();
+	if ((tag == "textarea" || tag == "input") &&
+		(element.hasAttribute("readonly") || element.hasAttribute("disabled")))
+		return false;
+
+	if (tag == "textarea")
+		return true;
+
+	if (tag == "input") {
+		QString type = element.attribute("type").toLower();
+		for (unsigned int i = 0; i < G_N_ELEMENTS(kNonTextInputTypes); i++) {
+			if (type == kNonTextInputTypes[i])
+				return false;
+		}
+		return true;
+	}
+
+	return element.hasAttribute("contenteditable") &&
+		   element.attribute("contenteditable").toLower() != "false";
+}
+
+// the visible part of the element's box in the main frame's viewport
+static QRect PrvViewportGeometry(const QWebElement& element)
+{
+	QRect rect = element.geometry();
+
+	// frame geometries are in the contents of their parent frame
+	for (QWebFrame* frame = element.webFrame(); frame; frame = frame->parentFrame()) {
+		rect.translate(-frame->scrollPosition());
+		if (frame->parentFrame())
+			rect = rect.translated(frame->geometry().topLeft()) & frame->geometry();
+	}
+
+	return rect;
+}
+
 //#define DEBUG_WEBAPP_INPUT_EVENTS 1
 
 WindowedWebApp::WindowedWebApp(int width, int height, WindowType::Type type, PIpcChannel *channel)
 	: m_data(0)
 	, m_metaDataBuffer(0)
 	, m_metaData(0)
+	, m_tileCache(0)
+	, m_thumbnail(0)
 	, m_winType(type)
 	, m_width(width)
 	, m_height(height)
@@ -66,12 +185,27 @@ WindowedWebApp::WindowedWebApp(int width, int height, WindowType::Type type, PIp
 	, m_addedToWindowMgr(false)
 	, m_windowWidth(-1)
 	, m_windowHeight(-1)
+	, m_paintSuppressed(false)
+	, m_displayOff(false)
+	, m_paintingInBackground(false)
+	, m_slicePaints(::getenv("LUNA_DISABLE_SLICED_PAINT") == 0)
+	, m_coalesceMotion(::getenv("LUNA_DISABLE_INPUT_COALESCING") == 0)
+	, m_hasPendingMotion(false)
+	, m_pendingMotionMerged(0)
+	, m_pendingMotionSinceUs(0)
+	, m_motionFlushSource(0)
+	, m_hostVisibilitySource(0)
+	, m_hostVisibilityPollMs(kHostVisibilityPollMs)
+	, m_dispatchingInput(false)
+	, m_editorFocusMoved(false)
 	, m_blockCount(0)
 	, m_blockPenEvents(false)
 	, m_lastGestureEndTime(0)
 	, m_showPageStats(false)
 	, m_focused(false)
 	, m_pendingFocus(PendingFocusNone)
+	, m_declaredOpacity(DeclaredOpacityNone)
+	, m_opaqueContent(false)
 	, m_showWindowTimer(WebAppManager::instance()->masterTimer(),
 						this, &WindowedWebApp::showWindowTimeout)
     , m_generateMouseClick(false)
@@ -96,6 +230,16 @@ WindowedWebApp::~WindowedWebApp()
 
 	stopPaintTimer();
 
+	if (m_motionFlushSource) {
+		g_source_destroy(m_motionFlushSource);
+		g_source_unref(m_motionFlushSource);
+	}
+
+	if (m_hostVisibilitySource) {
+		g_source_destroy(m_hostVisibilitySource);
+		g_source_unref(m_hostVisibilitySource);
+	}
+
     if (m_winType != WindowType::Type_ChildCard) {
 		if(m_data) {
 			m_channel->sendAsyncMessage(new ViewHost_RemoveWindow(routingId()));
@@ -104,6 +248,8 @@ WindowedWebApp::~WindowedWebApp()
 	}
 	// delete the page before m_data since webkit owns the gl context in gl compositing and needs to make it current when the layers get deleted
 	cleanResources();
+	delete m_tileCache;
+	delete m_thumbnail;
 	delete m_data;
 	delete m_metaDataBuffer;
 }
@@ -114,7 +260,10 @@ void WindowedWebApp::init()
 		return;
 	}
 
-	m_data = RemoteWindowDataFactory::generate(m_width, m_height, isTransparent());
+	// opaque full screen windows don't need the alpha channel: a 16bpp buffer
+	// from the start, if the host draws it that way
+	m_data = RemoteWindowDataFactory::generate(m_width, m_height, isTransparent(), wantsSharedSurface(),
+											   prefersRgb565Surface());
 	m_data->setChannel(m_channel);
 
 	m_metaDataBuffer = PIpcBuffer::create(sizeof(WindowMetaData));
@@ -124,6 +273,12 @@ void WindowedWebApp::init()
 	m_data->setWindowMetaDataBuffer(m_metaDataBuffer);
 
     m_data->setSupportsDirectRendering(m_winType == WindowType::Type_Card);
+
+	if (wantsTileCache())
+		m_tileCache = new WebAppTileCache;
+
+	if (wantsThumbnail())
+		m_thumbnail = new WebAppThumbnail(m_metaDataBuffer);
 }
 
 void WindowedWebApp::closeWindowRequest() 
@@ -151,10 +306,12 @@ void WindowedWebApp::attach(SysMgrWebBridge* page)
 
 
     connect(page, SIGNAL(signalInvalidateRect(const QRect&)), SLOT(slotInvalidateRect(const QRect&)));
+    connect(page, SIGNAL(signalScrollRequested(int, int, const QRect&)), SLOT(slotScrollRequested(int, int, const QRect&)));
     connect(page, SIGNAL(signalResizedContents(const QSize&)), SLOT(slotResizeContent(const QSize&)));
     connect(page, SIGNAL(signalGeometryChanged(const QRect&)), SLOT(slotGeometryChanged(const QRect&)));
 
     connect(page->page(), SIGNAL(windowCloseRequested()), this, SLOT(closeWindowRequest()));
+    connect(page->page(), SIGNAL(microFocusChanged()), this, SLOT(slotMicroFocusChanged()));
 
     page->page()->setViewportSize(QSize(m_windowWidth, m_windowHeight));
 
@@ -187,6 +344,10 @@ void WindowedWebApp::attach(SysMgrWebBridge* page)
 void WindowedWebApp::onMessageReceived(const PIpcMessage& msg)
 {
 	bool msgIsOk;
+
+	// keys, resizes, focus changes... see the motion received before them
+	if (msg.type() != View_InputEvent::ID)
+		flushMotion();
 	
 	IPC_BEGIN_MESSAGE_MAP(WindowedWebApp, msg, msgIsOk)
 		IPC_MESSAGE_HANDLER(View_Focus, focusedEvent)
@@ -255,6 +416,8 @@ void WindowedWebApp::onSyncResize(int width, int height, bool resizeBuffer, int*
 
 void WindowedWebApp::onAdjustForPositiveSpace(int width, int height)
 {
+	m_positiveSpace = QRect(0, 0, width, height);
+
 /*
 	if (!m_page || !m_page->webkitPage())
 		return;
@@ -356,43 +519,270 @@ void WindowedWebApp::paint()
 {
     stopPaintTimer();
 
+    if (paintHeldBack()) {
+        m_paintSuppressed = true;
+        watchHostVisibility();
+        return;
+    }
+
     if (!appLoaded())
         return;
 
+    // a frame that is being rendered in slices finishes before new damage
+    if (!m_paintSlices.empty()) {
+        paintSlice();
+        return;
+    }
+
     if (m_paintRect.isEmpty())
         return;
 
+    m_paintStats.paintStarted();
+
+    if (m_slicePaints && m_paintRect.width() * m_paintRect.height() >= kPaintSliceMinPixels) {
+        planPaintSlices(m_paintRect);
+        m_paintRect.setRect(0, 0, 0, 0);
+        paintSlice();
+        return;
+    }
+
     QPainter* ctxt = m_data->qtRenderingContext();
     m_data->beginPaint();
     ctxt->setCompositionMode(QPainter::CompositionMode_Source);
 
-    int px = m_paintRect.x();
-    int py = m_paintRect.y();
-    int pw = m_paintRect.width();
-    int ph = m_paintRect.height();
+    QRect rect = m_paintRect;
+    m_paintRect.setRect(0, 0, 0, 0);
 
-    ctxt->setClipRect(px, py, pw, ph);
-    ctxt->fillRect(m_paintRect,  Qt::transparent);
+    renderRect(ctxt, rect);
 
-    page()->page()->mainFrame()->render(ctxt, QWebFrame::ContentsLayer, m_paintRect);
+    m_data->endPaint(false, QRect());
 
-    m_paintRect.setRect(0, 0, 0, 0);
+    sendWindowUpdate(rect);
+
+    m_paintStats.paintFinished(rect.width() * rect.height());
+
+    if (!m_paintRect.isEmpty())
+        startPaintTimer();
+}
+
+void WindowedWebApp::renderRect(QPainter* ctxt, const QRect& rect)
+{
+    ctxt->setClipRect(rect);
+
+    // opaque pages overwrite every pixel anyway
+    if (!m_opaqueContent && !m_data->clearRect(rect))
+        ctxt->fillRect(rect,  Qt::transparent);
 
+    renderContents(ctxt, rect);
+}
+
+void WindowedWebApp::paintWithoutSlicing()
+{
+    // the buffer was just recreated or flipped: a partly rendered frame is
+    // worthless and the host expects the new one right away
+    if (!m_paintSlices.empty()) {
+        m_paintRect = (m_paintRect | m_slicedFrame) & QRect(0, 0, m_windowWidth, m_windowHeight);
+        m_paintSlices.clear();
+        m_slicedFrame = QRect();
+    }
+
+    bool slicePaints = m_slicePaints;
+    m_slicePaints = false;
+    paint();
+    m_slicePaints = slicePaints;
+}
+
+void WindowedWebApp::paintInBackground()
+{
+    if (m_displayOff)
+        return;
+
+    // the caller budgets whole frames, slices would wait for the host again
+    m_paintingInBackground = true;
+    paintWithoutSlicing();
+    m_paintingInBackground = false;
+
+    m_paintSuppressed = false;
+}
+
+void WindowedWebApp::planPaintSlices(const QRect& frame)
+{
+    QRect focus;
+    if (page() && page()->page())
+        focus = page()->page()->inputMethodQuery(Qt::ImMicroFocus).toRect();
+
+    QRect visible(0, 0, m_windowWidth, m_windowHeight);
+    if (!m_positiveSpace.isEmpty())
+        visible &= m_positiveSpace;
+
+    // what the user looks at or types into first, then the rest of the
+    // visible area top down, then whatever the keyboard covers
+    std::list<QRect> shown;
+    std::list<QRect> hidden;
+    for (int y = frame.top(); y <= frame.bottom(); y += kPaintSliceHeight) {
+        QRect band(frame.left(), y, frame.width(), qMin(kPaintSliceHeight, frame.bottom() + 1 - y));
+        if (band.intersects(focus))
+            m_paintSlices.push_back(band);
+        else if (band.intersects(visible))
+            shown.push_back(band);
+        else
+            hidden.push_back(band);
+    }
+
+    m_paintSlices.splice(m_paintSlices.end(), shown);
+    m_paintSlices.splice(m_paintSlices.end(), hidden);
+    m_slicedFrame = frame;
+}
+
+void WindowedWebApp::paintSlice()
+{
+    m_paintStats.paintResumed();
+    uint32_t start = Time::curTimeMs();
+
+    // the host may composite the window surface at any time, so the bands
+    // go into a back buffer and only the finished frame is copied over
+    if (m_sliceBuffer.size() != m_slicedFrame.size())
+        m_sliceBuffer = QImage(m_slicedFrame.size(), QImage::Format_ARGB32_Premultiplied);
+
+    QPainter slicePainter(&m_sliceBuffer);
+    slicePainter.translate(-m_slicedFrame.topLeft());
+    slicePainter.setCompositionMode(QPainter::CompositionMode_Source);
+
+    // always make progress, then stop once the budget is used up so input
+    // and IPC get a turn before the next slice
+    do {
+        QRect band = m_paintSlices.front();
+        m_paintSlices.pop_front();
+
+        slicePainter.setClipRect(band);
+        if (!m_opaqueContent)
+            slicePainter.fillRect(band, Qt::transparent);
+        renderContents(&slicePainter, band);
+    } while (!m_paintSlices.empty() && Time::curTimeMs() - start < kPaintSliceBudgetMs);
+
+    slicePainter.end();
+
+    if (!m_paintSlices.empty()) {
+        m_paintStats.paintSuspended();
+        startPaintTimer();
+        return;
+    }
+
+    QPainter* ctxt = m_data->qtRenderingContext();
+    m_data->beginPaint();
+    ctxt->setCompositionMode(QPainter::CompositionMode_Source);
+    ctxt->setClipRect(m_slicedFrame);
+    ctxt->drawImage(m_slicedFrame.topLeft(), m_sliceBuffer);
     m_data->endPaint(false, QRect());
 
-    m_data->sendWindowUpdate(px, py, pw, ph);
+    sendWindowUpdate(m_slicedFrame);
+    m_paintStats.paintFinished(m_slicedFrame.width() * m_slicedFrame.height());
+    m_slicedFrame = QRect();
 
     if (!m_paintRect.isEmpty())
         startPaintTimer();
 }
 
+void WindowedWebApp::renderContents(QPainter* painter, const QRect& rect)
+{
+    page()->page()->mainFrame()->render(painter, QWebFrame::ContentsLayer, QRegion(rect));
+}
+
 void WindowedWebApp::onInputEvent(const SysMgrEventWrapper& wrapper)
 {
-	Event* evt = new Event;
-	memcpy(&(evt->type), &(wrapper.event->type), sizeof(SysMgrEvent));
+	ThreadPriorityManager::instance()->hold(ThreadPriorityManager::Input, kInputPriorityMs);
+
+	const SysMgrEvent& e = *wrapper.event;
+	uint64_t now = WebAppPaintStats::currentTimeUs();
+
+	if (m_coalesceMotion && (e.type == Event::PenMove || e.type == Event::GestureChange)) {
+		queueMotion(e, now);
+		return;
+	}
+
+	// pen down/up, flicks, gesture start/end and the like keep their place
+	// behind the motion that came before them
+	flushMotion();
+	deliverInputEvent(e, now, 0);
+}
+
+void WindowedWebApp::queueMotion(const SysMgrEvent& e, uint64_t receivedUs)
+{
+	// positions, gesture scale and rotation are absolute, so the latest event
+	// carries everything the dropped ones did. a change of modifiers has to
+	// be seen though
+	if (m_hasPendingMotion &&
+		(m_pendingMotion.type != e.type || m_pendingMotion.modifiers != e.modifiers))
+		flushMotion();
 
-	sptr<Event> e = evt;
-	inputEvent(e);
+	if (m_hasPendingMotion) {
+		memcpy(&m_pendingMotion, &e, sizeof(SysMgrEvent));
+		m_pendingMotionMerged++;
+		return;
+	}
+
+	memcpy(&m_pendingMotion, &e, sizeof(SysMgrEvent));
+	m_hasPendingMotion = true;
+	m_pendingMotionMerged = 0;
+	m_pendingMotionSinceUs = receivedUs;
+
+	// at default priority the source runs after the ipc messages that are
+	// already waiting, which is the burst we want to merge
+	if (!m_motionFlushSource) {
+		m_motionFlushSource = g_idle_source_new();
+		g_source_set_priority(m_motionFlushSource, G_PRIORITY_DEFAULT);
+		g_source_set_callback(m_motionFlushSource, WindowedWebApp::motionFlushCallback, this, NULL);
+		g_source_attach(m_motionFlushSource, g_main_context_default());
+	}
+}
+
+void WindowedWebApp::flushMotion()
+{
+	if (m_motionFlushSource) {
+		g_source_destroy(m_motionFlushSource);
+		g_source_unref(m_motionFlushSource);
+		m_motionFlushSource = 0;
+	}
+
+	if (!m_hasPendingMotion)
+		return;
+
+	m_hasPendingMotion = false;
+	deliverInputEvent(m_pendingMotion, m_pendingMotionSinceUs, m_pendingMotionMerged);
+}
+
+gboolean WindowedWebApp::motionFlushCallback(gpointer arg)
+{
+	WindowedWebApp* app = static_cast<WindowedWebApp*>(arg);
+
+	g_source_unref(app->m_motionFlushSource);
+	app->m_motionFlushSource = 0;
+	app->flushMotion();
+
+	return FALSE;
+}
+
+void WindowedWebApp::deliverInputEvent(const SysMgrEvent& e, uint64_t receivedUs, int merged)
+{
+	// every event is copied into the same Event. only an event delivered
+	// while the page still handles the previous one (from a nested main loop)
+	// gets its own
+	sptr<Event> ev = m_inputEvent;
+	if (m_dispatchingInput || !ev.get()) {
+		ev = sptr<Event>(new Event);
+		m_paintStats.inputEventAllocated();
+		if (!m_dispatchingInput)
+			m_inputEvent = ev;
+	}
+
+	memcpy(&(ev->type), &(e.type), sizeof(SysMgrEvent));
+
+	bool nested = m_dispatchingInput;
+	m_dispatchingInput = true;
+	inputEvent(ev);
+	m_dispatchingInput = nested;
+
+	m_paintStats.inputDelivered(WebAppPaintStats::currentTimeUs() - receivedUs, merged);
 }
 
 void WindowedWebApp::inputEvent(sptr<Event> e)
@@ -404,50 +794,18 @@ void WindowedWebApp::inputEvent(sptr<Event> e)
     Event* evt = e.get();
 
     if(Event::isPenEvent(evt)) {
-        if (evt->type == Event::PenDown) {
-            QMouseEvent* qtEvent = new QMouseEvent(QEvent::MouseButtonPress, QPoint(evt->x, evt->y), Qt::LeftButton, Qt::LeftButton, 0);
-            bridge->page()->event(qtEvent);
-        } else if (evt->type == Event::PenUp) {
-            QMouseEvent* qtEvent = new QMouseEvent(QEvent::MouseButtonRelease, QPoint(evt->x, evt->y), Qt::LeftButton, Qt::LeftButton, 0);
-            bridge->page()->event(qtEvent);
-            QWebHitTestResult hitTest = bridge->page()->mainFrame()->hitTestContent(QPoint(evt->x, evt->y));
-            if (hitTest.isContentEditable()) {
-                QWebElement element = hitTest.element();
-                QString palmType = element.attribute("x-palm-input-type");
-                QString attrType = element.attribute("type");
-                QString inputType = !palmType.isEmpty() ? palmType : attrType;
-                PalmIME::EditorState state;
-                if(inputType.isEmpty() || !(inputType.compare("text", Qt::CaseInsensitive)))
-                    state.type = PalmIME::FieldType_Text;
-                else if(!(inputType.compare("password", Qt::CaseInsensitive))) 
-                    state.type = PalmIME::FieldType_Password;
-                else if(!(inputType.compare("search", Qt::CaseInsensitive))) 
-                    state.type = PalmIME::FieldType_Search;
-                else if(!(inputType.compare("range", Qt::CaseInsensitive))) 
-                    state.type = PalmIME::FieldType_Range;
-                else if(!(inputType.compare("email", Qt::CaseInsensitive))) 
-                    state.type = PalmIME::FieldType_Email;
-                else if(!(inputType.compare("number", Qt::CaseInsensitive))) 
-                    state.type = PalmIME::FieldType_Number;
-                else if(!(inputType.compare("itel", Qt::CaseInsensitive))) 
-                    state.type = PalmIME::FieldType_Phone;
-                else if(!(inputType.compare("url", Qt::CaseInsensitive))) 
-                    state.type = PalmIME::FieldType_URL;
-                else if(!(inputType.compare("color", Qt::CaseInsensitive))) 
-                    state.type = PalmIME::FieldType_Color;
-                else
-                    state.type = PalmIME::FieldType_Text;
-
-                editorFocusChanged(true, state);
-            } else {
-                editorFocusChanged(false, PalmIME::EditorState());
-            }
-        } else if (evt->type == Event::PenMove) {
-            QMouseEvent* qtEvent = new QMouseEvent(QEvent::MouseMove, QPoint(evt->x, evt->y), Qt::NoButton, Qt::NoButton, 0);
-            bridge->page()->event(qtEvent);
+        const PenEventTranslation* translation = PrvPenEventTranslation(evt->type);
+        if (translation) {
+            QMouseEvent qtEvent(translation->qtType, QPoint(evt->x, evt->y),
+                                translation->button, translation->buttons, Qt::NoModifier);
+            bridge->page()->event(&qtEvent);
+        }
+
+        if (evt->type == Event::PenUp) {
+            // the press above moved the focus if it was going to
+            updateEditorFocus(QPoint(evt->x, evt->y));
         } else if (evt->type == Event::PenFlick) {
-            QString script = QString().sprintf("if (window.Mojo && window.Mojo.handleGesture) {window.Mojo.handleGesture('flick', {x: %d, y: %d, timeStamp: %u, xVel: %d, yVel: %d})}", evt->x, evt->y, evt->time, evt->flickXVel, evt->flickYVel);
-            page()->page()->mainFrame()->evaluateJavaScript(script);
+            bridge->events()->flick(evt->x, evt->y, evt->time, evt->flickXVel, evt->flickYVel);
         }
     }
 /*
@@ -666,6 +1024,8 @@ void WindowedWebApp::inputEvent(sptr<Event> e)
 
 void WindowedWebApp::onKeyEvent(const SysMgrKeyEvent& e)
 {
+    ThreadPriorityManager::instance()->hold(ThreadPriorityManager::Input, kInputPriorityMs);
+
     QKeyEvent ev = e.qtEvent();
     if (ev.key() == Qt::Key_Enter || ev.key() == Qt::Key_Return) {
         // Trap both key Enter and Return and make sure that we pass the key code as Qt::Key_Enter
@@ -682,6 +1042,8 @@ void WindowedWebApp::onKeyEvent(const SysMgrKeyEvent& e)
 
 void WindowedWebApp::onTouchEvent(const SysMgrTouchEvent& e)
 {
+	ThreadPriorityManager::instance()->hold(ThreadPriorityManager::Input, kInputPriorityMs);
+
 /*
 	// sending this directly to webkit
 	if (!m_page || !m_page->webkitPage()) {
@@ -857,15 +1219,13 @@ void WindowedWebApp::focusedEvent(bool focused)
 			  appId().c_str());
 */
     m_focused = focused;
-    // The script will tie into the EnyoFW so that the javascritp apps get their 
-    // windowActivated and windowDeActivated signals respectively
-    QString script;
-    if (focused) {
+    updateThrottleState();
+
+    // The framework ties this into the EnyoFW so that the javascript apps get
+    // their windowActivated and windowDeActivated signals respectively
+    if (focused)
         WebAppManager::instance()->setActiveAppId(page()->getIdentifier());
-        script = QString("if (window.Mojo && Mojo.stageActivated) {Mojo.stageActivated();}");
-    } else
-        script = QString("if (window.Mojo && Mojo.stageDeactivated) {Mojo.stageDeactivated();}");
-    page()->page()->mainFrame()->evaluateJavaScript(script);
+    page()->events()->stageActivated(focused);
 
     QFocusEvent fEvent(QEvent::FocusIn);
     page()->event(&fEvent);
@@ -922,7 +1282,7 @@ int WindowedWebApp::resizeEvent(int newWidth, int newHeight, bool resizeBuffer)
     resizeWebPage(newWidth, newHeight);
 
 	m_paintRect.setRect(0, 0, newWidth, newHeight);
-    paint();
+    paintWithoutSlicing();
 
 	WebAppManager::instance()->windowedAppKeyChanged(this, oldKey);
 
@@ -945,7 +1305,7 @@ void WindowedWebApp::flipEvent(int newWidth, int newHeight)
     WebAppBase::resizeWebPage(m_windowWidth, m_windowHeight);
 
 	m_paintRect.setRect(0, 0, m_windowWidth, m_windowHeight);
-    paint();
+    paintWithoutSlicing();
 }
 
 void WindowedWebApp::asyncFlipEvent(int newWidth, int newHeight, int newScreenWidth, int newScreenHeight)
@@ -963,7 +1323,7 @@ void WindowedWebApp::asyncFlipEvent(int newWidth, int newHeight, int newScreenWi
     WebAppBase::resizeWebPage(m_windowWidth, m_windowHeight);
 
 	m_paintRect.setRect(0, 0, m_windowWidth, m_windowHeight);
-    paint();
+    paintWithoutSlicing();
 
 	// notify Host that this window is done resizing
 	m_channel->sendAsyncMessage(new ViewHost_AsyncFlipCompleted(routingId(), newWidth, newHeight, newScreenWidth, newScreenHeight));
@@ -979,6 +1339,10 @@ void WindowedWebApp::invalContents(int x, int y, int width, int height)
 
     // Union (Combine) the rectanage to create a final rect
     m_paintRect |= interSection;
+    m_paintStats.damageAdded();
+
+    if (m_tileCache)
+        m_tileCache->invalidate(interSection);
 
     startPaintTimer();
 }
@@ -988,6 +1352,11 @@ void WindowedWebApp::slotInvalidateRect(const QRect& rect)
     invalContents(rect.x(), rect.y(), rect.width(), rect.height());
 }
 
+void WindowedWebApp::slotScrollRequested(int dx, int dy, const QRect& rectToScroll)
+{
+    scrollRect(dx, dy, rectToScroll);
+}
+
 void WindowedWebApp::slotResizeContent(const QSize& rect)
 {
     qDebug() << __PRETTY_FUNCTION__ << rect;
@@ -1003,12 +1372,100 @@ void WindowedWebApp::scrollContents(int newContentsX, int newContentsY)
     invalidate();
 }
 
+void WindowedWebApp::scrollRect(int dx, int dy, const QRect& rectToScroll)
+{
+    QRect clip = rectToScroll & QRect(0, 0, m_windowWidth, m_windowHeight);
+    if (clip.isEmpty())
+        return;
+
+    // nothing to move while the host or the display isn't showing us
+    if (paintHeldBack()) {
+        invalContents(clip.x(), clip.y(), clip.width(), clip.height());
+        return;
+    }
+
+    // a half rendered frame can't be moved around
+    if (!m_paintSlices.empty()) {
+        invalContents(clip.x(), clip.y(), clip.width(), clip.height());
+        return;
+    }
+
+    // pending damage has to be in the buffer before we move its pixels
+    if (!m_paintRect.isEmpty())
+        paint();
+
+    // the damage was big enough to start a sliced frame, which can't be
+    // moved around either
+    QRect src = clip.translated(-dx, -dy) & clip;
+    if (src.isEmpty() || !m_paintRect.isEmpty() || !m_paintSlices.empty() || !appLoaded()) {
+        invalContents(clip.x(), clip.y(), clip.width(), clip.height());
+        return;
+    }
+
+    m_paintStats.damageAdded();
+    m_paintStats.paintStarted();
+
+    QPainter* ctxt = m_data->qtRenderingContext();
+    m_data->beginPaint();
+
+    if (!m_data->scrollRect(src, dx, dy)) {
+        m_data->endPaint(false, QRect());
+        invalContents(clip.x(), clip.y(), clip.width(), clip.height());
+        return;
+    }
+
+    // render only the strips the scroll exposed
+    QRect dst = src.translated(dx, dy);
+    QRect exposed[2];
+    if (dy > 0)
+        exposed[0] = QRect(clip.left(), clip.top(), clip.width(), dy);
+    else if (dy < 0)
+        exposed[0] = QRect(clip.left(), clip.bottom() + 1 + dy, clip.width(), -dy);
+    if (dx > 0)
+        exposed[1] = QRect(clip.left(), dst.top(), dx, dst.height());
+    else if (dx < 0)
+        exposed[1] = QRect(clip.right() + 1 + dx, dst.top(), -dx, dst.height());
+
+    int pixels = 0;
+    ctxt->setCompositionMode(QPainter::CompositionMode_Source);
+    for (int i = 0; i < 2; i++) {
+        if (exposed[i].isEmpty())
+            continue;
+
+        pixels += exposed[i].width() * exposed[i].height();
+
+        ctxt->setClipRect(exposed[i]);
+        if (!m_opaqueContent && !m_data->clearRect(exposed[i]))
+            ctxt->fillRect(exposed[i], Qt::transparent);
+        renderContents(ctxt, exposed[i]);
+    }
+
+    m_data->endPaint(false, QRect());
+
+    // cached tiles still hold the old positions
+    if (m_tileCache)
+        m_tileCache->invalidate(clip);
+
+    sendWindowUpdate(clip);
+
+    m_paintStats.paintFinished(pixels);
+}
+
 void WindowedWebApp::startPaintTimer()
 {
     // will call us after we are deleted
     if (m_beingDeleted)
         return;
 
+    // keep the damage, checkHostVisibility() or repaintAfterDisplayOn() paint
+    // it when we show again
+    if (paintHeldBack()) {
+        m_paintStats.paintSuppressed();
+        m_paintSuppressed = true;
+        watchHostVisibility();
+        return;
+    }
+
     if (!m_paintTimer)
     {
         m_paintTimer = new QTimer(this);
@@ -1026,6 +1483,141 @@ void WindowedWebApp::stopPaintTimer()
     }
 }
 
+void WindowedWebApp::sendWindowUpdate(const QRect& rect)
+{
+    // repaints that produced the same pixels aren't worth a round trip to the host
+    if (m_data->hashesUpdates()) {
+        bool unchanged = m_data->contentUnchanged(rect);
+        m_paintStats.updateHashed(unchanged);
+        if (unchanged)
+            return;
+    }
+
+    m_data->sendWindowUpdate(rect.x(), rect.y(), rect.width(), rect.height());
+}
+
+bool WindowedWebApp::hostOccluded() const
+{
+    return m_metaData && m_metaData->hostVisibility != WindowMetaData::HostVisible;
+}
+
+void WindowedWebApp::checkHostVisibility()
+{
+    if (!m_paintSuppressed || paintHeldBack())
+        return;
+
+    // a single render for everything that changed while we were hidden
+    m_paintSuppressed = false;
+    paint();
+}
+
+void WindowedWebApp::watchHostVisibility()
+{
+    // displayOn() takes care of what was held back for the display
+    if (m_hostVisibilitySource || m_displayOff || !hostOccluded())
+        return;
+
+    m_hostVisibilitySource = g_timeout_source_new(m_hostVisibilityPollMs);
+    g_source_set_priority(m_hostVisibilitySource, G_PRIORITY_DEFAULT);
+    g_source_set_callback(m_hostVisibilitySource, WindowedWebApp::hostVisibilityCallback, this, NULL);
+    g_source_attach(m_hostVisibilitySource, g_main_context_default());
+}
+
+gboolean WindowedWebApp::hostVisibilityCallback(gpointer arg)
+{
+    WindowedWebApp* app = static_cast<WindowedWebApp*>(arg);
+
+    g_source_unref(app->m_hostVisibilitySource);
+    app->m_hostVisibilitySource = 0;
+
+    // still hidden: look again later, the longer it stays hidden the less
+    // likely it shows up any moment now
+    if (app->m_paintSuppressed && !app->m_displayOff && app->hostOccluded()) {
+        app->m_hostVisibilityPollMs = qMin(app->m_hostVisibilityPollMs * 2, kHostVisibilityMaxPollMs);
+        app->watchHostVisibility();
+        return FALSE;
+    }
+
+    app->m_hostVisibilityPollMs = kHostVisibilityPollMs;
+    app->checkHostVisibility();
+    return FALSE;
+}
+
+void WindowedWebApp::updateThrottleState()
+{
+    if (!page() || !page()->throttle())
+        return;
+
+    // cards the user isn't looking at only run in the background, other
+    // windows (dashboards, alerts, ...) show without having focus
+    WebPageThrottle::State state = WebPageThrottle::Active;
+    if (inCache() || !WebAppManager::instance()->isDisplayOn())
+        state = WebPageThrottle::Frozen;
+    else if (!m_focused && (m_winType == WindowType::Type_Card ||
+                            m_winType == WindowType::Type_ChildCard))
+        state = WebPageThrottle::Background;
+
+    page()->throttle()->setState(state);
+}
+
+void WindowedWebApp::displayOff()
+{
+    // damage keeps merging into m_paintRect and the tile cache, without
+    // paint timers waking us up for it
+    m_displayOff = true;
+    stopPaintTimer();
+
+    // nothing is shown with the display off, repaintAfterDisplayOn() starts
+    // watching again from the shortest interval if we're still held back
+    if (m_hostVisibilitySource) {
+        g_source_destroy(m_hostVisibilitySource);
+        g_source_unref(m_hostVisibilitySource);
+        m_hostVisibilitySource = 0;
+    }
+    m_hostVisibilityPollMs = kHostVisibilityPollMs;
+}
+
+void WindowedWebApp::displayOn()
+{
+    m_displayOff = false;
+}
+
+void WindowedWebApp::repaintAfterDisplayOn(bool immediately)
+{
+    if (paintHeldBack()) {
+        if (m_paintSuppressed)
+            watchHostVisibility();
+        return;
+    }
+
+    if (immediately) {
+        m_paintSuppressed = false;
+        paint();
+    }
+    else if (m_paintSuppressed) {
+        m_paintSuppressed = false;
+        startPaintTimer();
+    }
+}
+
+int WindowedWebApp::releaseMemory()
+{
+    int bytes = 0;
+
+    // only needed again for the next sliced frame
+    if (m_paintSlices.empty() && !m_sliceBuffer.isNull()) {
+        bytes += m_sliceBuffer.byteCount();
+        m_sliceBuffer = QImage();
+    }
+
+    if (m_tileCache) {
+        bytes += m_tileCache->memoryUsage();
+        m_tileCache->purge();
+    }
+
+    return bytes;
+}
+
 void WindowedWebApp::invalidate()
 {
     slotInvalidateRect(QRect(0,0,m_windowWidth, m_windowHeight));
@@ -1038,6 +1630,8 @@ void WindowedWebApp::PrvCbPaintTimeout()
 
 void WindowedWebApp::loadFinished()
 {
+	updateOpaqueContent();
+
 /*	
 	if (m_page) {
 		bool hasMojo = true;
@@ -1149,6 +1743,9 @@ void WindowedWebApp::stageReady()
 	m_stagePreparing = false;
 	m_stageReady = true;
 	page()->setStageReadyPending(false);
+
+	// the framework has set up the scene by now
+	updateOpaqueContent();
 	
     if (!m_addedToWindowMgr && m_winType != WindowType::Type_ChildCard) {
 
@@ -1174,6 +1771,49 @@ void WindowedWebApp::stageReady()
 	}
 }
 
+void WindowedWebApp::slotMicroFocusChanged()
+{
+	// typing and caret moves within the field we know about. It keeps the
+	// focus through the focus in and out editorFocusChanged() sends as well
+	if (!m_editorFocusElement.isNull() && m_editorFocusElement.hasFocus())
+		return;
+
+	QWebElement element;
+	QWebFrame* frame = (page() && page()->page()) ? page()->page()->currentFrame() : 0;
+	if (frame)
+		element = frame->findFirstElement(":focus");
+	if (!PrvIsEditable(element))
+		element = QWebElement();
+
+	if (element == m_editorFocusElement)
+		return;
+
+	m_editorFocusElement = element;
+	m_editorFocusState = PalmIME::EditorState();
+	if (!element.isNull())
+		m_editorFocusState.type = PrvEditorFieldType(element);
+
+	m_editorFocusMoved = true;
+}
+
+void WindowedWebApp::updateEditorFocus(const QPoint& pos)
+{
+	if (m_editorFocusMoved) {
+		if (!m_editorFocusElement.isNull())
+			editorFocusChanged(true, m_editorFocusState);
+		else
+			editorFocusChanged(false, PalmIME::EditorState());
+	}
+	else if (!m_editorFocusElement.isNull() &&
+			 PrvViewportGeometry(m_editorFocusElement).contains(pos)) {
+		// a tap into the field that has the focus already brings the keyboard
+		// back, also after the host dismissed it
+		editorFocusChanged(true, m_editorFocusState);
+	}
+
+	m_editorFocusMoved = false;
+}
+
 void WindowedWebApp::editorFocusChanged(bool focused, const PalmIME::EditorState& state)
 {
 	// ignore requests from dashboard's, alert's or anything that isn't a card & windowed
@@ -1402,6 +2042,117 @@ void WindowedWebApp::keyGesture(QKeyEvent* e)
     */
 }
 
+void WindowedWebApp::setOpaqueSurface(bool opaque)
+{
+	m_declaredOpacity = opaque ? DeclaredOpacityOpaque : DeclaredOpacityTranslucent;
+	updateOpaqueContent();
+
+	// shared atlas surfaces are always 32bpp, declaring opacity only spares
+	// the host the blending
+	if (!m_data || isTransparent() || wantsSharedSurface())
+		return;
+
+	if (m_data->usesRgb565() == opaque)
+		return;
+
+	// a host that doesn't look at the surface format would read 16bpp pixels
+	// as 32bpp ones
+	if (opaque && !hostSupportsRgb565())
+		return;
+
+	if (!m_data->setUseRgb565(opaque)) {
+		g_warning("%s: failed to switch window surface to %s", __PRETTY_FUNCTION__,
+				  opaque ? "RGB565" : "ARGB32");
+		return;
+	}
+
+	// the buffer contents were reset: repaint everything
+	invalidate();
+}
+
+bool WindowedWebApp::hostSupportsRgb565() const
+{
+	// LUNA_RGB565_SURFACES is for hosts known to read the format before they
+	// get to acknowledge it in the metadata
+	return ::getenv("LUNA_RGB565_SURFACES") ||
+		   (m_metaData && m_metaData->hostSupportsRgb565);
+}
+
+bool WindowedWebApp::prefersRgb565Surface() const
+{
+	// the buffer is allocated before the host can see the metadata, only the
+	// startup opt in counts
+	if (isTransparent() || !::getenv("LUNA_RGB565_SURFACES"))
+		return false;
+
+	return ((m_winType == WindowType::Type_Card) ||
+			(m_winType == WindowType::Type_Launcher));
+}
+
+bool WindowedWebApp::wantsTileCache() const
+{
+	if (::getenv("LUNA_DISABLE_TILECACHE"))
+		return false;
+
+	// only cards on surfaces without partial updates repaint more than the
+	// damage, everywhere else the tiles would just be rendered and copied
+	return (m_winType == WindowType::Type_Card) &&
+		   m_data && !m_data->supportsPartialUpdates();
+}
+
+bool WindowedWebApp::wantsThumbnail() const
+{
+	if (::getenv("LUNA_DISABLE_THUMBNAILS"))
+		return false;
+
+	// child cards are drawn into their parent's buffer
+	return m_winType == WindowType::Type_Card;
+}
+
+bool WindowedWebApp::wantsSharedSurface() const
+{
+	// once there is a buffer, only a window that actually got an atlas rect counts
+	if (m_data)
+		return m_data->sharesSurface();
+
+	// the window is routed by its metadata buffer key, which a host that
+	// doesn't know about atlases would map as pixels. The routing key is fixed
+	// before the host can acknowledge anything, so only the startup opt in counts
+	if (!::getenv("LUNA_WINDOW_ATLAS"))
+		return false;
+
+	return ((m_winType == WindowType::Type_Dashboard) ||
+			(m_winType == WindowType::Type_PopupAlert) ||
+			(m_winType == WindowType::Type_BannerAlert));
+}
+
+void WindowedWebApp::updateOpaqueContent()
+{
+	bool opaque = false;
+
+	if (m_declaredOpacity != DeclaredOpacityNone) {
+		// an explicit window property wins over anything we can guess
+		opaque = m_declaredOpacity == DeclaredOpacityOpaque;
+	}
+	else if (page() && page()->page() && !isTransparent()) {
+		// non transparent window types keep webkit's opaque base color under
+		// the document. Page styles can change at any time without telling
+		// us, so they aren't guessed from: translucent pages have to declare
+		// themselves through the window properties.
+		opaque = page()->page()->palette().color(QPalette::Base).alpha() == 255;
+	}
+
+	if (opaque == m_opaqueContent)
+		return;
+
+	m_opaqueContent = opaque;
+	if (m_metaData)
+		m_metaData->opaque = opaque;
+
+	g_debug("%s: %s content is %s", __PRETTY_FUNCTION__,
+			appId().toUtf8().constData(), opaque ? "opaque" : "translucent");
+}
+
 bool WindowedWebApp::isTransparent() const
 {
     return ((m_winType == WindowType::Type_Menu) ||
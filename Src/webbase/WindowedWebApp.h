@@ -31,16 +31,22 @@
 #include "sptr.h"
 #include "Event.h"
 #include "Timer.h"
+#include "WebAppPaintStats.h"
 #include "WindowProperties.h"
 #include "WindowTypes.h"
 #include <PIpcChannelListener.h>
 #include <PIpcBuffer.h>
+#include <QImage>
 #include <QRect>
+#include <QWebElement>
 
 class SysMgrKeyEvent;
 class QKeyEvent;
+class QPainter;
 class SysMgrTouchEvent;
 class RemoteWindowData;
+class WebAppThumbnail;
+class WebAppTileCache;
 class WindowMetaData;
 class QTimer;
 
@@ -56,6 +62,10 @@ public:
 
     virtual void paint();
 
+	// renders page contents in rect (window coordinates) through painter
+	virtual void renderContents(QPainter* painter, const QRect& rect);
+
+	// the event is reused for the next one, handlers must not keep it
 	virtual void inputEvent(sptr<Event>);
 	virtual void keyEvent(QKeyEvent* e);
 	virtual void focusedEvent(bool focused);
@@ -117,8 +127,37 @@ public:
 	
 	virtual void setWindowProperties(WindowProperties &winProp);
 
-	virtual void displayOn() {}
-	virtual void displayOff() {}
+	// page declared itself (not) fully opaque: pick the buffer format to match
+	void setOpaqueSurface(bool opaque);
+
+	// every pixel of the page is painted opaque, so damage doesn't need to be
+	// cleared before rendering
+	bool opaqueContent() const { return m_opaqueContent; }
+
+	const WebAppPaintStats& paintStats() const { return m_paintStats; }
+
+	// true while the host has the window covered or off screen
+	bool hostOccluded() const;
+	// true while paints are held back, for the host or the display
+	bool paintHeldBack() const { return m_displayOff || (hostOccluded() && !m_paintingInBackground); }
+
+	// renders the pending damage of an occluded window in one go, so it's up
+	// to date when the host shows it again. Still held back with the display off
+	void paintInBackground();
+
+	// slows the page's timers down to match focus, caching and the display
+	void updateThrottleState();
+
+	// drops what only speeds up painting (tiles, scratch surfaces) while the
+	// window isn't shown. returns the number of bytes released
+	virtual int releaseMemory();
+
+	// while the display is off nothing is painted, damage is merged until
+	// repaintAfterDisplayOn() renders it in one go. immediately paints right
+	// away, and even without damage, otherwise the paint is queued
+	virtual void displayOn();
+	virtual void displayOff();
+	void repaintAfterDisplayOn(bool immediately);
 	
 public Q_SLOTS:
     /*!
@@ -135,6 +174,7 @@ protected:
 	virtual void unfocus();
     virtual void invalContents(int x, int y, int width, int height);
     virtual void scrollContents(int newContentsX, int newContentsY);
+    virtual void scrollRect(int dx, int dy, const QRect& rectToScroll);
 	virtual void loadFinished();
 	virtual void stagePreparing();
 	virtual void stageReady();
@@ -145,14 +185,41 @@ protected:
 
 protected Q_SLOTS:
     void slotInvalidateRect(const QRect&);
+    void slotScrollRequested(int dx, int dy, const QRect&);
     void slotResizeContent(const QSize&);
     void slotGeometryChanged(const QRect&);
+    void slotMicroFocusChanged();
 
 protected:
 
 	void startPaintTimer();
 	void stopPaintTimer();
 
+	void renderRect(QPainter* ctxt, const QRect& rect);
+
+	// after a tap at pos, tells the host about the editable element that got
+	// the focus, or that there is none
+	void updateEditorFocus(const QPoint& pos);
+	void paintWithoutSlicing();
+	void planPaintSlices(const QRect& frame);
+	void paintSlice();
+
+	// tells the host about rect unless its content turned out unchanged
+	void sendWindowUpdate(const QRect& rect);
+
+	// pen moves and gesture changes wait for the end of the main loop
+	// iteration, a run of them only delivers the latest one
+	void queueMotion(const SysMgrEvent& e, uint64_t receivedUs);
+	void flushMotion();
+	void deliverInputEvent(const SysMgrEvent& e, uint64_t receivedUs, int merged);
+	static gboolean motionFlushCallback(gpointer arg);
+
+	// renders the damage held back while occluded once the window shows again
+	void checkHostVisibility();
+	// polls the host's visibility while paints are held back for it
+	void watchHostVisibility();
+	static gboolean hostVisibilityCallback(gpointer arg);
+
 	enum PendingFocus {
 		PendingFocusNone = 0,
 		PendingFocusTrue,
@@ -162,6 +229,9 @@ protected:
 	RemoteWindowData* m_data;
 	PIpcBuffer* m_metaDataBuffer;
 	WindowMetaData* m_metaData;
+	WebAppTileCache* m_tileCache;
+	WebAppThumbnail* m_thumbnail;
+	WebAppPaintStats m_paintStats;
 
     WindowType::Type	m_winType;
 	int					m_width;
@@ -175,6 +245,38 @@ protected:
 	uint32_t            m_windowHeight;
 
 	QRect m_paintRect;
+	bool m_paintSuppressed;
+	bool m_displayOff;
+	bool m_paintingInBackground;
+
+	// large damage is rendered in bands spread over several main loop
+	// iterations into a back buffer, which is copied to the window surface
+	// and sent to the host once the whole frame is done
+	bool m_slicePaints;
+	std::list<QRect> m_paintSlices;
+	QRect m_slicedFrame;
+	QImage m_sliceBuffer;
+	QRect m_positiveSpace;
+
+	bool m_coalesceMotion;
+	SysMgrEvent m_pendingMotion;
+	bool m_hasPendingMotion;
+	int m_pendingMotionMerged;
+	uint64_t m_pendingMotionSinceUs;	// arrival of the oldest merged event
+	GSource* m_motionFlushSource;
+	GSource* m_hostVisibilitySource;
+	int m_hostVisibilityPollMs;
+
+	// input from the ipc channel is delivered in this one event
+	sptr<Event> m_inputEvent;
+	bool m_dispatchingInput;
+
+	// the focused editable element with its classification, kept up to date
+	// as the page moves focus. Moved is set when it changed since the last
+	// pen up
+	bool m_editorFocusMoved;
+	QWebElement m_editorFocusElement;
+	PalmIME::EditorState m_editorFocusState;
 
 	int  m_blockCount; //Keeps track on how many PenDown's we blocked.
 	bool m_blockPenEvents;
@@ -183,6 +285,15 @@ protected:
 	bool m_focused;
 	PendingFocus m_pendingFocus;
 
+	enum DeclaredOpacity {
+		DeclaredOpacityNone = 0,
+		DeclaredOpacityOpaque,
+		DeclaredOpacityTranslucent
+	};
+
+	DeclaredOpacity m_declaredOpacity;
+	bool m_opaqueContent;
+
 	Timer<WindowedWebApp> m_showWindowTimer;
 
     bool m_generateMouseClick;
@@ -199,6 +310,12 @@ protected:
 	bool showWindowTimeout();
 	bool appLoaded() const;
 	bool isTransparent() const;
+	bool prefersRgb565Surface() const;
+	bool hostSupportsRgb565() const;
+	bool wantsTileCache() const;
+	bool wantsThumbnail() const;
+	bool wantsSharedSurface() const;
+	void updateOpaqueContent();
 	
 private:
 
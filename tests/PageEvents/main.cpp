@@ -0,0 +1,136 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+// Microbenchmark for delivering system events to a page. Compares generating
+// and evaluating a script per event, as WindowedWebApp and CardWebApp used to,
+// with emitting the signals of WebPageEvents the page's shim is connected to.
+//
+// usage: pageeventsbench [iterations]
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QVariant>
+#include <QWebFrame>
+#include <QWebPage>
+
+#include "WebPageEvents.h"
+
+static int s_iterations = 10000;
+
+// counts what reaches the framework, so both paths can be checked to do the same
+static const char* kMojoStub =
+	"window.Mojo = {"
+	"  calls: 0,"
+	"  handleGesture: function(type, args) { if (type == 'flick' && args.xVel == 3) this.calls++; },"
+	"  show: function() { this.calls++; },"
+	"  hide: function() { this.calls++; },"
+	"  relaunch: function() { this.calls++; return true; }"
+	"};";
+
+static int mojoCalls(QWebFrame* frame)
+{
+	return frame->evaluateJavaScript("var c = Mojo.calls; Mojo.calls = 0; c").toInt();
+}
+
+static bool report(const char* what, const char* impl, qint64 nsecs, int calls)
+{
+	printf("%-10s %-8s %10.2f us/event\n", what, impl, (double) nsecs / s_iterations / 1000.0);
+	if (calls != s_iterations) {
+		printf("  FAILED: %d of %d events reached Mojo\n", calls, s_iterations);
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	QApplication app(argc, argv);
+
+	if (argc >= 2)
+		s_iterations = atoi(argv[1]);
+
+	if (s_iterations <= 0) {
+		printf("usage: %s [iterations]\n", argv[0]);
+		return 1;
+	}
+
+	QWebPage page;
+	QWebFrame* frame = page.mainFrame();
+	frame->setHtml("<html><body></body></html>");
+	frame->evaluateJavaScript(kMojoStub);
+
+	WebPageEvents events(&page);
+	events.windowObjectCleared();
+
+	printf("%d events\n\n", s_iterations);
+
+	QElapsedTimer timer;
+	bool ok = true;
+
+	timer.start();
+	for (int i = 0; i < s_iterations; i++) {
+		QString script = QString().sprintf("if (window.Mojo && window.Mojo.handleGesture) {window.Mojo.handleGesture('flick', {x: %d, y: %d, timeStamp: %u, xVel: %d, yVel: %d})}",
+										   i % 320, i % 480, (unsigned int) i, 3, -7);
+		frame->evaluateJavaScript(script);
+	}
+	ok = report("flick", "script", timer.nsecsElapsed(), mojoCalls(frame)) && ok;
+
+	timer.start();
+	for (int i = 0; i < s_iterations; i++)
+		events.flick(i % 320, i % 480, i, 3, -7);
+	ok = report("flick", "signal", timer.nsecsElapsed(), mojoCalls(frame)) && ok;
+
+	timer.start();
+	for (int i = 0; i < s_iterations; i++)
+		frame->evaluateJavaScript((i & 1) ? "if (window.Mojo && Mojo.hide) Mojo.hide()"
+										  : "if (window.Mojo && Mojo.show) Mojo.show()");
+	ok = report("show/hide", "script", timer.nsecsElapsed(), mojoCalls(frame)) && ok;
+
+	timer.start();
+	for (int i = 0; i < s_iterations; i++) {
+		if (i & 1)
+			events.hide();
+		else
+			events.show();
+	}
+	ok = report("show/hide", "signal", timer.nsecsElapsed(), mojoCalls(frame)) && ok;
+
+	int relaunched = 0;
+	timer.start();
+	for (int i = 0; i < s_iterations; i++) {
+		QVariant ret = frame->evaluateJavaScript(QString("Mojo.relaunch()"));
+		if (ret.isValid() && ret.toBool())
+			relaunched++;
+	}
+	ok = report("relaunch", "script", timer.nsecsElapsed(), mojoCalls(frame)) && ok;
+	ok = (relaunched == s_iterations) && ok;
+
+	relaunched = 0;
+	timer.start();
+	for (int i = 0; i < s_iterations; i++) {
+		if (events.relaunch())
+			relaunched++;
+	}
+	ok = report("relaunch", "signal", timer.nsecsElapsed(), mojoCalls(frame)) && ok;
+	ok = (relaunched == s_iterations) && ok;
+
+	return ok ? 0 : 1;
+}
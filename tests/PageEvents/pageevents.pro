@@ -0,0 +1,27 @@
+TEMPLATE = app
+
+CONFIG += qt no_keywords
+
+QT += webkit
+
+QT_VERSION=$$[QT_VERSION]
+contains(QT_VERSION, "^5.*") {
+    QT += widgets webkitwidgets
+}
+
+VPATH += ../../Src/webbase
+
+INCLUDEPATH += \
+	../../Src/webbase \
+	$$(LUNA_STAGING)/include/luna-sysmgr-common \
+	$$(STAGING_INCDIR)/luna-sysmgr-common
+
+SOURCES = main.cpp WebPageEvents.cpp
+HEADERS = WebPageEvents.h
+
+QMAKE_CXXFLAGS += -fno-rtti -fno-exceptions
+
+MOC_DIR = $$DESTDIR/.moc
+OBJECTS_DIR = $$DESTDIR/.obj
+
+TARGET = pageeventsbench
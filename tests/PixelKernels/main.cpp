@@ -0,0 +1,269 @@
+/* @@@LICENSE
+*
+*      Copyright (c) 2013 LG Electronics, Inc.
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+* http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*
+* LICENSE@@@ */
+
+// Microbenchmark for the window surface pixel kernels. Compares the memset /
+// QPainter paths used by RemoteWindowDataSoftwareQt and WindowedWebApp::paint
+// with every PixelKernels implementation the cpu supports.
+//
+// usage: pixelkernelsbench [width height [iterations]]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include <QElapsedTimer>
+#include <QImage>
+#include <QPainter>
+#include <QTransform>
+
+#include "PixelKernels.h"
+
+static int s_width = 1024;
+static int s_height = 768;
+static int s_iterations = 200;
+
+static void report(const char* what, const char* impl, qint64 nsecs, qint64 bytes)
+{
+	double perIter = (double) nsecs / s_iterations / 1000.0;
+	double mbPerSec = (double) bytes * s_iterations / ((double) nsecs / 1e9) / (1024.0 * 1024.0);
+	printf("%-28s %-8s %10.1f us/iter %10.1f MB/s\n", what, impl, perIter, mbPerSec);
+}
+
+static bool verify(const uint32_t* buf, int stride, const QRect& r, uint32_t value)
+{
+	for (int y = r.top(); y <= r.bottom(); y++) {
+		const uint32_t* row = reinterpret_cast<const uint32_t*>(reinterpret_cast<const uint8_t*>(buf) + y * stride);
+		for (int x = r.left(); x <= r.right(); x++) {
+			if (row[x] != value)
+				return false;
+		}
+	}
+	return true;
+}
+
+static void benchBaseline(uint32_t* dst, uint32_t* src, int stride, const QRect& damage)
+{
+	QElapsedTimer timer;
+	const qint64 fullBytes = (qint64) stride * s_height;
+	const qint64 damageBytes = (qint64) damage.width() * damage.height() * sizeof(uint32_t);
+
+	timer.start();
+	for (int i = 0; i < s_iterations; i++)
+		memset(dst, 0, fullBytes);
+	report("full clear", "memset", timer.nsecsElapsed(), fullBytes);
+
+	QImage image(reinterpret_cast<uchar*>(dst), s_width, s_height, QImage::Format_ARGB32_Premultiplied);
+	QPainter painter;
+
+	timer.start();
+	for (int i = 0; i < s_iterations; i++) {
+		painter.begin(&image);
+		painter.setCompositionMode(QPainter::CompositionMode_Source);
+		painter.setClipRect(damage);
+		painter.fillRect(damage, Qt::transparent);
+		painter.end();
+	}
+	report("damage clear", "qpainter", timer.nsecsElapsed(), damageBytes);
+
+	timer.start();
+	for (int i = 0; i < s_iterations; i++) {
+		painter.begin(&image);
+		painter.setCompositionMode(QPainter::CompositionMode_Source);
+		painter.fillRect(0, 0, s_width, s_height, QColor(0xFF, 0xFF, 0xFF));
+		painter.end();
+	}
+	report("full fill", "qpainter", timer.nsecsElapsed(), fullBytes);
+
+	timer.start();
+	for (int i = 0; i < s_iterations; i++)
+		memcpy(dst, src, fullBytes);
+	report("full copy", "memcpy", timer.nsecsElapsed(), fullBytes);
+
+	QImage srcImage(reinterpret_cast<uchar*>(src), s_width, s_height, QImage::Format_ARGB32_Premultiplied);
+
+	timer.start();
+	for (int i = 0; i < s_iterations; i++) {
+		painter.begin(&image);
+		painter.setCompositionMode(QPainter::CompositionMode_Source);
+		painter.drawImage(damage.topLeft(), srcImage, damage.translated(1, 1));
+		painter.end();
+	}
+	report("damage blit", "qpainter", timer.nsecsElapsed(), damageBytes);
+
+	// what a card in a non upright orientation costs through a rotated transform
+	QImage rotatedImage(reinterpret_cast<uchar*>(dst), s_height, s_width, QImage::Format_ARGB32_Premultiplied);
+	QTransform rotation;
+	rotation.translate(s_height, 0);
+	rotation.rotate(90);
+
+	timer.start();
+	for (int i = 0; i < s_iterations; i++) {
+		painter.begin(&rotatedImage);
+		painter.setCompositionMode(QPainter::CompositionMode_Source);
+		painter.setTransform(rotation);
+		painter.drawImage(0, 0, srcImage);
+		painter.end();
+	}
+	report("full rotate 90", "qpainter", timer.nsecsElapsed(), fullBytes);
+
+	// card switcher thumbnail at a quarter of the size
+	timer.start();
+	for (int i = 0; i < s_iterations; i++)
+		srcImage.scaled(s_width / 4, s_height / 4, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+	report("full downscale 4", "qimage", timer.nsecsElapsed(), fullBytes);
+}
+
+static bool benchKernels(const char* impl, uint32_t* dst, uint32_t* src, int stride, const QRect& damage)
+{
+	if (!PixelKernels::setImplementation(impl))
+		return true;
+
+	QElapsedTimer timer;
+	const qint64 fullBytes = (qint64) stride * s_height;
+	const qint64 damageBytes = (qint64) damage.width() * damage.height() * sizeof(uint32_t);
+	bool ok = true;
+
+	timer.start();
+	for (int i = 0; i < s_iterations; i++)
+		PixelKernels::clearRect(dst, stride, 0, 0, s_width, s_height);
+	report("full clear", impl, timer.nsecsElapsed(), fullBytes);
+	ok = ok && verify(dst, stride, QRect(0, 0, s_width, s_height), 0);
+
+	PixelKernels::fill(dst, stride, 0, 0, s_width, s_height, 0xFFFFFFFF);
+
+	timer.start();
+	for (int i = 0; i < s_iterations; i++)
+		PixelKernels::clearRect(dst, stride, damage.x(), damage.y(), damage.width(), damage.height());
+	report("damage clear", impl, timer.nsecsElapsed(), damageBytes);
+	ok = ok && verify(dst, stride, damage, 0);
+	ok = ok && verify(dst, stride, QRect(0, 0, s_width, damage.top()), 0xFFFFFFFF);
+
+	timer.start();
+	for (int i = 0; i < s_iterations; i++)
+		PixelKernels::fill(dst, stride, 0, 0, s_width, s_height, 0xFFFFFFFF);
+	report("full fill", impl, timer.nsecsElapsed(), fullBytes);
+	ok = ok && verify(dst, stride, QRect(0, 0, s_width, s_height), 0xFFFFFFFF);
+
+	timer.start();
+	for (int i = 0; i < s_iterations; i++)
+		PixelKernels::copy(dst, src, s_width * s_height);
+	report("full copy", impl, timer.nsecsElapsed(), fullBytes);
+	ok = ok && memcmp(dst, src, fullBytes) == 0;
+
+	timer.start();
+	for (int i = 0; i < s_iterations; i++)
+		PixelKernels::blit(dst, stride, damage.x(), damage.y(),
+						   src, stride, damage.x() + 1, damage.y() + 1,
+						   damage.width(), damage.height());
+	report("damage blit", impl, timer.nsecsElapsed(), damageBytes);
+	ok = ok && memcmp(reinterpret_cast<uint8_t*>(dst) + damage.y() * stride + damage.x() * 4,
+					  reinterpret_cast<uint8_t*>(src) + (damage.y() + 1) * stride + (damage.x() + 1) * 4,
+					  damage.width() * 4) == 0;
+
+	const int rotatedStride = s_height * sizeof(uint32_t);
+	for (int angle = 90; angle < 360; angle += 90) {
+		const int dstStride = angle == 180 ? stride : rotatedStride;
+
+		timer.start();
+		for (int i = 0; i < s_iterations; i++)
+			PixelKernels::rotate(dst, dstStride, 0, 0, src, stride, 0, 0,
+								 s_width, s_height, sizeof(uint32_t), angle);
+
+		char what[32];
+		snprintf(what, sizeof(what), "full rotate %d", angle);
+		report(what, impl, timer.nsecsElapsed(), fullBytes);
+
+		// spot check the corner that lands at the origin
+		uint32_t corner = src[0];
+		if (angle == 90)
+			corner = src[(s_height - 1) * s_width];
+		else if (angle == 180)
+			corner = src[s_height * s_width - 1];
+		else if (angle == 270)
+			corner = src[s_width - 1];
+		ok = ok && dst[0] == corner;
+	}
+
+	for (int factor = 4; factor <= 8; factor *= 2) {
+		timer.start();
+		for (int i = 0; i < s_iterations; i++)
+			PixelKernels::downscale(dst, stride, 0, 0, src, stride, 0, 0,
+									s_width / factor, s_height / factor, sizeof(uint32_t), factor);
+
+		char what[32];
+		snprintf(what, sizeof(what), "full downscale %d", factor);
+		report(what, impl, timer.nsecsElapsed(), fullBytes);
+
+		// every source pixel is opaque, so is their average
+		ok = ok && (dst[0] >> 24) == 0xFF;
+	}
+
+	timer.start();
+	for (int i = 0; i < s_iterations; i++)
+		PixelKernels::crossfade(dst, stride, src, stride, src, stride,
+								s_width, s_height, sizeof(uint32_t), 64 + i % 128);
+	report("full crossfade", impl, timer.nsecsElapsed(), fullBytes);
+	ok = ok && memcmp(dst, src, fullBytes) == 0;
+
+	if (!ok)
+		printf("%s: FAILED verification\n", impl);
+
+	return ok;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc >= 3) {
+		s_width = atoi(argv[1]);
+		s_height = atoi(argv[2]);
+	}
+	if (argc >= 4)
+		s_iterations = atoi(argv[3]);
+
+	if (s_width < 16 || s_height < 16 || s_iterations <= 0) {
+		printf("usage: %s [width height [iterations]]\n", argv[0]);
+		return 1;
+	}
+
+	const int stride = s_width * sizeof(uint32_t);
+	uint32_t* dst = static_cast<uint32_t*>(malloc(stride * s_height));
+	uint32_t* src = static_cast<uint32_t*>(malloc(stride * s_height));
+	for (int i = 0; i < s_width * s_height; i++)
+		src[i] = 0xFF000000 | (i * 2654435761u >> 8);
+
+	// a typical damaged region: an odd sized, unaligned strip in the middle of the window
+	QRect damage(s_width / 8 + 3, s_height / 3, s_width / 2 + 5, s_height / 6);
+
+	printf("surface %dx%d, damage %dx%d, %d iterations, default implementation %s\n\n",
+		   s_width, s_height, damage.width(), damage.height(), s_iterations,
+		   PixelKernels::implementationName());
+
+	benchBaseline(dst, src, stride, damage);
+	printf("\n");
+
+	bool ok = true;
+	const char* impls[] = { "c", "sse2", "avx2", "neon" };
+	for (unsigned int i = 0; i < sizeof(impls) / sizeof(impls[0]); i++)
+		ok = benchKernels(impls[i], dst, src, stride, damage) && ok;
+
+	free(dst);
+	free(src);
+
+	return ok ? 0 : 1;
+}
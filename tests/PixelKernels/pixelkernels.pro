@@ -0,0 +1,24 @@
+TEMPLATE = app
+
+CONFIG += qt no_keywords link_pkgconfig
+
+PKGCONFIG = glib-2.0
+
+QT += gui
+
+VPATH += ../../Src/webbase
+
+INCLUDEPATH += \
+	../../Src/webbase \
+	$$(LUNA_STAGING)/include/luna-sysmgr-common \
+	$$(STAGING_INCDIR)/luna-sysmgr-common
+
+SOURCES = main.cpp PixelKernels.cpp
+HEADERS = PixelKernels.h
+
+QMAKE_CXXFLAGS += -fno-rtti -fno-exceptions
+
+MOC_DIR = $$DESTDIR/.moc
+OBJECTS_DIR = $$DESTDIR/.obj
+
+TARGET = pixelkernelsbench
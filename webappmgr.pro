@@ -87,6 +87,7 @@ SOURCES += \
         BackupManager.cpp \
         BannerMessageEventFactory.cpp \
         CardWebApp.cpp \
+        CpuLoadSampler.cpp \
         DashboardWebApp.cpp \
         DeviceInfo.cpp \
         DockWebApp.cpp \
@@ -96,10 +97,12 @@ SOURCES += \
         Main.cpp \
         MemoryWatcher.cpp \
         PalmSystem.cpp \
+        PixelKernels.cpp \
         ProcessManager.cpp \
         RemoteWindowData.cpp \
         SyncTask.cpp \
         SysMgrWebBridge.cpp \
+        ThreadPriorityManager.cpp \
         WebAppBase.cpp \
         WebAppCache.cpp \
         WebAppDeferredUpdateHandler.cpp \
@@ -107,7 +110,14 @@ SOURCES += \
         WebAppFactoryMinimal.cpp \
         WebAppFactoryLuna.cpp \
         WebAppManager.cpp \
+        WebAppPaintStats.cpp \
+        WebAppRotateTransition.cpp \
+        WebAppThumbnail.cpp \
+        WebAppTileCache.cpp \
+        WebAppWindowAtlas.cpp \
         WebKitEventListener.cpp \
+        WebPageEvents.cpp \
+        WebPageThrottle.cpp \
         WindowedWebApp.cpp
 
 HEADERS += \
@@ -116,6 +126,7 @@ HEADERS += \
         BackupManager.h \
         BannerMessageEventFactory.h \
         CardWebApp.h \
+        CpuLoadSampler.h \
         DashboardWebApp.h \
         Debug.h \
         DeviceInfo.h \
@@ -126,6 +137,7 @@ HEADERS += \
         MemoryWatcher.h \
         NewContentIndicatorEventFactory.h \
         PalmSystem.h \
+        PixelKernels.h \
         ProcessBase.h \
         ProcessManager.h \
         RemoteWindowData.h \
@@ -133,6 +145,7 @@ HEADERS += \
         SyncTask.h \
         SysMgrWebBridge.h \
         SystemUiController.h \
+        ThreadPriorityManager.h \
         WebAppBase.h \
         WebAppCache.h \
         WebAppDeferredUpdateHandler.h \
@@ -140,7 +153,14 @@ HEADERS += \
         WebAppFactoryMinimal.h \
         WebAppFactoryLuna.h \
         WebAppManager.h \
+        WebAppPaintStats.h \
+        WebAppRotateTransition.h \
+        WebAppThumbnail.h \
+        WebAppTileCache.h \
+        WebAppWindowAtlas.h \
         WebKitEventListener.h \
+        WebPageEvents.h \
+        WebPageThrottle.h \
         WindowedWebApp.h \
         WindowMetaData.h
 
@@ -201,10 +221,12 @@ contains(CONFIG_BUILD, opengl) {
         }
         SOURCES += \
             # HostWindowDataOpenGL.cpp \
+            RemoteWindowDataSoftwareAtlas.cpp \
             RemoteWindowDataSoftwareQt.cpp \
             RemoteWindowDataOpenGLQt.cpp
         HEADERS += \
             # HostWindowDataOpenGL.h \
+            RemoteWindowDataSoftwareAtlas.h \
             RemoteWindowDataSoftwareQt.h \
             RemoteWindowDataOpenGLQt.h
             # RemoteWindowDataOpenGL.h \
@@ -213,8 +235,8 @@ contains(CONFIG_BUILD, opengl) {
 }
 else {
     DEFINES += P_BACKEND=P_BACKEND_SOFT
-    SOURCES += RemoteWindowDataSoftwareQt.cpp
-    HEADERS += RemoteWindowDataSoftwareQt.h
+    SOURCES += RemoteWindowDataSoftwareAtlas.cpp RemoteWindowDataSoftwareQt.cpp
+    HEADERS += RemoteWindowDataSoftwareAtlas.h RemoteWindowDataSoftwareQt.h
 }
 
 contains(CONFIG_BUILD, directrendering) {